@@ -0,0 +1,246 @@
+#pragma once
+
+#include "ip_address.hpp"
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <format>
+#include <numeric>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Network address with a prefix length, host bits are always cleared
+class CIDR final
+{
+private:
+    IPaddress m_network;
+    uint8_t m_prefix{0};
+
+public:
+    static constexpr uint8_t MAX_PREFIX = 32;
+
+    constexpr CIDR() noexcept = default;
+
+    constexpr CIDR(IPaddress address, uint8_t prefix) noexcept
+        : m_network{address.to_uint32() & mask(prefix)}, m_prefix{prefix}
+    {
+        assert(prefix <= MAX_PREFIX);
+    }
+
+    // netmask for prefix, e.g. 24 -> 0xFFFFFF00
+    static constexpr uint32_t mask(uint8_t prefix) noexcept
+    {
+        assert(prefix <= MAX_PREFIX);
+        return prefix == 0 ? 0 : ~uint32_t{0} << (MAX_PREFIX - prefix);
+    }
+
+    constexpr IPaddress network() const noexcept { return m_network; }
+    constexpr uint8_t prefix() const noexcept { return m_prefix; }
+
+    constexpr bool contains(IPaddress address) const noexcept
+    {
+        return (address.to_uint32() & mask(m_prefix)) ==
+               m_network.to_uint32();
+    }
+
+    constexpr bool operator==(const CIDR&) const noexcept = default;
+
+    inline std::string to_string() const
+    {
+        return std::format("{}/{}", m_network.to_string(), m_prefix);
+    }
+
+    // "a.b.c.d/n", the address part is validated as in IPaddress::try_parse
+    static constexpr ip_error try_parse(std::string_view str,
+                                        CIDR& result) noexcept
+    {
+        const size_t slash{str.find('/')};
+        if (slash == std::string_view::npos)
+            return ip_error::invalid_prefix;
+
+        uint32_t address{0};
+        const ip_error error{
+            ip_detail::parse_ipv4(str.substr(0, slash), address)};
+        if (error != ip_error::ok)
+            return error;
+
+        const std::string_view digits{str.substr(slash + 1)};
+        if (digits.empty() || digits.size() > 2 ||
+            !std::ranges::all_of(digits, ip_detail::is_digit) ||
+            (digits.size() == 2 && digits[0] == '0'))
+            return ip_error::invalid_prefix;
+
+        uint32_t prefix{0};
+        for (const char ch : digits)
+            prefix = prefix * 10 + static_cast<uint32_t>(ch - '0');
+        if (prefix > MAX_PREFIX)
+            return ip_error::invalid_prefix;
+
+        result = CIDR{IPaddress{address}, static_cast<uint8_t>(prefix)};
+        return ip_error::ok;
+    }
+
+    // Compile time only, a malformed rule fails the build
+    static consteval CIDR parse(std::string_view str)
+    {
+        CIDR result;
+        if (try_parse(str, result) != ip_error::ok)
+            throw std::invalid_argument{"CIDR::parse: bad CIDR"};
+        return result;
+    }
+
+    static inline CIDR create_CIDR(const std::string& str)
+    {
+        CIDR result;
+        const ip_error error{try_parse(str, result)};
+        if (error != ip_error::ok)
+            throw std::invalid_argument{
+                std::format("{}: bad CIDR ({})", str, ::to_string(error))};
+        return result;
+    }
+};
+
+namespace ip_literals
+{
+// "10.0.0.0/8"_cidr
+consteval CIDR operator""_cidr(const char* str, size_t length)
+{
+    return CIDR::parse({str, length});
+}
+} // namespace ip_literals
+
+// RFC 1918 private ranges, built at compile time
+inline constexpr std::array<CIDR, 3> PRIVATE_NETWORKS{
+    CIDR::parse("10.0.0.0/8"), CIDR::parse("172.16.0.0/12"),
+    CIDR::parse("192.168.0.0/16")};
+
+constexpr bool is_private(IPaddress address) noexcept
+{
+    return std::ranges::any_of(PRIVATE_NETWORKS, [address](const CIDR& network)
+                               { return network.contains(address); });
+}
+
+static_assert(is_private(IPaddress::parse("172.31.255.255")));
+static_assert(!is_private(IPaddress::parse("172.32.0.0")));
+
+// Immutable DIR-24-8 longest prefix match table. The top 24 bits index a
+// 2^24 entry table; prefixes longer than /24 get a 256 entry group in a
+// second table. A lookup is one or two memory accesses.
+// Lookups return the index of the matching rule in the constructor input.
+class lpm_table final
+{
+public:
+    static constexpr uint32_t NO_MATCH = UINT32_MAX;
+
+    explicit lpm_table(std::span<const CIDR> rules)
+        : m_tbl24(size_t{1} << 24, EMPTY)
+    {
+        if (rules.size() >= EXTENDED)
+            throw std::length_error{"lpm_table: too many rules"};
+
+        // shorter prefixes first, so longer ones overwrite them
+        std::vector<uint32_t> order(rules.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::ranges::stable_sort(order, {}, [&rules](uint32_t i)
+                                 { return rules[i].prefix(); });
+
+        for (const uint32_t i : order)
+            _insert(rules[i], i + 1);
+    }
+
+    inline uint32_t lookup(IPaddress address) const noexcept
+    {
+        const uint32_t value{address.to_uint32()};
+        uint32_t entry{m_tbl24[value >> 8]};
+        if (entry & EXTENDED)
+            entry = m_tbl8[(entry & ~EXTENDED) * 256 + (value & 0xFF)];
+        return entry - 1;
+    }
+
+    // Software pipelined: the first level entry of the address
+    // PREFETCH_DISTANCE elements ahead is requested while the current one
+    // is resolved. results must be at least as large as addresses.
+    inline void lookup(std::span<const IPaddress> addresses,
+                       std::span<uint32_t> results) const noexcept
+    {
+        const size_t count{addresses.size()};
+        for (size_t i{0}; i < count; ++i)
+        {
+            if (i + PREFETCH_DISTANCE < count)
+                _prefetch(
+                    &m_tbl24[addresses[i + PREFETCH_DISTANCE].to_uint32() >>
+                             8]);
+            results[i] = lookup(addresses[i]);
+        }
+    }
+
+    size_t memory_usage() const noexcept
+    {
+        return (m_tbl24.size() + m_tbl8.size()) * sizeof(uint32_t);
+    }
+
+private:
+    // entries hold rule index + 1, or a tbl8 group number with EXTENDED set
+    static constexpr uint32_t EMPTY = 0;
+    static constexpr uint32_t EXTENDED = 0x80000000u;
+    static constexpr size_t PREFETCH_DISTANCE = 16;
+
+    std::vector<uint32_t> m_tbl24;
+    std::vector<uint32_t> m_tbl8;
+
+    static inline void _prefetch(const void* address) noexcept
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        __builtin_prefetch(address);
+#else
+        (void)address;
+#endif
+    }
+
+    void _insert(const CIDR& rule, uint32_t entry)
+    {
+        const uint32_t network{rule.network().to_uint32()};
+        if (rule.prefix() <= 24)
+        {
+            const size_t first{network >> 8};
+            const size_t count{size_t{1} << (24 - rule.prefix())};
+            std::fill_n(m_tbl24.begin() + first, count, entry);
+            return;
+        }
+
+        uint32_t& slot{m_tbl24[network >> 8]};
+        if (!(slot & EXTENDED))
+        {
+            // the new group inherits the covering /24-or-shorter match
+            const auto group{static_cast<uint32_t>(m_tbl8.size() / 256)};
+            m_tbl8.resize(m_tbl8.size() + 256, slot);
+            slot = group | EXTENDED;
+        }
+
+        const size_t first{(slot & ~EXTENDED) * 256 + (network & 0xFF)};
+        const size_t count{size_t{1} << (CIDR::MAX_PREFIX - rule.prefix())};
+        std::fill_n(m_tbl8.begin() + first, count, entry);
+    }
+};
+
+// Reference for tests and benchmarks: checks every rule, later rules win
+// among equal prefixes just like in lpm_table
+inline uint32_t linear_lookup(std::span<const CIDR> rules,
+                              IPaddress address) noexcept
+{
+    uint32_t best{lpm_table::NO_MATCH};
+    int best_prefix{-1};
+    for (uint32_t i{0}; i < rules.size(); ++i)
+    {
+        if (rules[i].prefix() >= best_prefix && rules[i].contains(address))
+        {
+            best = i;
+            best_prefix = rules[i].prefix();
+        }
+    }
+    return best;
+}
@@ -0,0 +1,175 @@
+#pragma once
+
+#include "mapped_file.hpp"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <span>
+#include <stdexcept>
+#include <string>
+
+// Binary font of fixed size bitmap glyphs, integers little endian:
+//   0    "RFA1"
+//   4    uint16 glyph width in pixels
+//   6    uint16 glyph height in pixels
+//   8    uint16 glyph count
+//   10   uint16 reserved, 0
+//   12   uint16[256] index, glyph number of every byte value or MISSING
+//   524  glyph count bitmaps of height rows, each row (width + 7) / 8
+//        bytes with the leftmost pixel in the highest bit of the first byte
+// Unused low bits of a row are 0.
+class font_atlas final
+{
+public:
+    static constexpr std::array<uint8_t, 4> MAGIC{'R', 'F', 'A', '1'};
+    static constexpr size_t INDEX_OFFSET = 12;
+    static constexpr size_t BITMAP_OFFSET = INDEX_OFFSET + 256 * 2;
+    static constexpr uint16_t MISSING = 0xFFFF;
+
+    static constexpr size_t row_bytes(size_t width) noexcept
+    {
+        return (width + 7) / 8;
+    }
+
+    static constexpr size_t file_size(size_t width, size_t height,
+                                      size_t count) noexcept
+    {
+        return BITMAP_OFFSET + count * height * row_bytes(width);
+    }
+
+    // A view, bytes must outlive it. Only the header is checked, glyphs are
+    // read in place.
+    constexpr explicit font_atlas(std::span<const uint8_t> bytes)
+        : m_bytes{bytes.data()}
+    {
+        if (bytes.size() < BITMAP_OFFSET ||
+            !std::equal(MAGIC.begin(), MAGIC.end(), bytes.begin()))
+            throw std::invalid_argument{"font_atlas: bad header"};
+
+        m_width = _read16(4);
+        m_height = _read16(6);
+        m_count = _read16(8);
+        m_row_bytes = row_bytes(m_width);
+        if (m_width == 0 || m_height == 0 ||
+            bytes.size() < file_size(m_width, m_height, m_count))
+            throw std::invalid_argument{"font_atlas: truncated glyphs"};
+        for (size_t ch{0}; ch < 256; ++ch)
+        {
+            const uint16_t glyph{_read16(INDEX_OFFSET + 2 * ch)};
+            if (glyph != MISSING && glyph >= m_count)
+                throw std::invalid_argument{"font_atlas: bad index"};
+        }
+    }
+
+    constexpr size_t width() const noexcept { return m_width; }
+    constexpr size_t height() const noexcept { return m_height; }
+    constexpr size_t count() const noexcept { return m_count; }
+    // bytes of one glyph row
+    constexpr size_t row_bytes() const noexcept { return m_row_bytes; }
+
+    // Rows of the glyph for ch, nullptr when the font has none
+    constexpr const uint8_t* glyph(char ch) const noexcept
+    {
+        const uint16_t glyph{
+            _read16(INDEX_OFFSET + 2 * static_cast<unsigned char>(ch))};
+        return glyph == MISSING ? nullptr
+                                : m_bytes + BITMAP_OFFSET +
+                                      glyph * m_height * m_row_bytes;
+    }
+
+private:
+    const uint8_t* m_bytes;
+    size_t m_width{0};
+    size_t m_height{0};
+    size_t m_count{0};
+    size_t m_row_bytes{0};
+
+    constexpr uint16_t _read16(size_t offset) const noexcept
+    {
+        return static_cast<uint16_t>(m_bytes[offset] |
+                                     m_bytes[offset + 1] << 8);
+    }
+};
+
+// Writes the atlas of the glyphs for chars to out, which needs
+// font_atlas::file_size() bytes. ink(glyph, y, x) tells whether pixel
+// (x, y) of the glyph for chars[glyph] is set; a repeated char maps to its
+// last glyph. Usable at compile time.
+template <class Ink, class OutputIt>
+constexpr OutputIt write_font_atlas(std::span<const char> chars, size_t width,
+                                    size_t height, Ink&& ink, OutputIt out)
+{
+    if (width == 0 || height == 0 || width > UINT16_MAX ||
+        height > UINT16_MAX || chars.size() >= font_atlas::MISSING)
+        throw std::invalid_argument{"write_font_atlas: bad glyph size"};
+
+    const auto put16{[&out](size_t value)
+                     {
+                         *out++ = static_cast<uint8_t>(value);
+                         *out++ = static_cast<uint8_t>(value >> 8);
+                     }};
+
+    out = std::copy(font_atlas::MAGIC.begin(), font_atlas::MAGIC.end(), out);
+    put16(width);
+    put16(height);
+    put16(chars.size());
+    put16(0);
+
+    std::array<uint16_t, 256> index;
+    index.fill(font_atlas::MISSING);
+    for (size_t glyph{0}; glyph < chars.size(); ++glyph)
+        index[static_cast<unsigned char>(chars[glyph])] =
+            static_cast<uint16_t>(glyph);
+    for (const uint16_t glyph : index)
+        put16(glyph);
+
+    for (size_t glyph{0}; glyph < chars.size(); ++glyph)
+        for (size_t y{0}; y < height; ++y)
+            for (size_t first{0}; first < width; first += 8)
+            {
+                uint8_t bits{0};
+                for (size_t x{first}; x < std::min(first + 8, width); ++x)
+                    if (ink(glyph, y, x))
+                        bits |= static_cast<uint8_t>(0x80 >> (x - first));
+                *out++ = bits;
+            }
+    return out;
+}
+
+// Font atlas file mapped into memory, glyphs are never copied
+class mapped_font final
+{
+public:
+    explicit mapped_font(const std::string& path)
+        : m_file{path}, m_atlas{_check(m_file, path)}
+    {
+    }
+
+    const font_atlas& atlas() const noexcept { return m_atlas; }
+
+private:
+    mapped_font(const mapped_font&) = delete;
+    mapped_font(mapped_font&&) noexcept = delete;
+    mapped_font& operator=(const mapped_font&) = delete;
+    mapped_font& operator=(mapped_font&&) noexcept = delete;
+
+    mapped_file m_file;
+    font_atlas m_atlas;
+
+    static font_atlas _check(const mapped_file& file, const std::string& path)
+    {
+        try
+        {
+            return font_atlas{std::span{
+                reinterpret_cast<const uint8_t*>(file.data()), file.size()}};
+        }
+        catch (const std::invalid_argument& error)
+        {
+            throw std::runtime_error(std::format(
+                "[FATAL] \"{}\" is not a font atlas ({})!", path,
+                error.what()));
+        }
+    }
+};
@@ -0,0 +1,516 @@
+#pragma once
+
+#include "probe.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <functional>
+#include <regex>
+#include <source_location>
+#include <span>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define IP_PARSER_SSE2
+#endif
+
+// Result of the non-throwing parser
+enum class ip_error : uint8_t
+{
+    ok,
+    empty,
+    too_long,
+    invalid_character,
+    wrong_octet_count,
+    empty_octet,
+    leading_zero,
+    octet_out_of_range,
+    invalid_prefix,
+    wrong_group_count,
+    group_out_of_range,
+    misplaced_compression,
+    invalid_zone
+};
+
+constexpr std::string_view to_string(ip_error error) noexcept
+{
+    switch (error)
+    {
+    case ip_error::ok:
+        return "ok";
+    case ip_error::empty:
+        return "empty address";
+    case ip_error::too_long:
+        return "address is too long";
+    case ip_error::invalid_character:
+        return "invalid character";
+    case ip_error::wrong_octet_count:
+        return "wrong number of octets";
+    case ip_error::empty_octet:
+        return "empty octet";
+    case ip_error::leading_zero:
+        return "octet has leading zero";
+    case ip_error::octet_out_of_range:
+        return "octet is out of range";
+    case ip_error::invalid_prefix:
+        return "invalid prefix length";
+    case ip_error::wrong_group_count:
+        return "wrong number of groups";
+    case ip_error::group_out_of_range:
+        return "group is out of range";
+    case ip_error::misplaced_compression:
+        return "misplaced \"::\"";
+    case ip_error::invalid_zone:
+        return "invalid zone id";
+    }
+    return "unknown error";
+}
+
+namespace ip_detail
+{
+// "255.255.255.255"
+inline constexpr size_t MAX_IPV4_LENGTH = 15;
+// "0.0.0.0"
+inline constexpr size_t MIN_IPV4_LENGTH = 7;
+
+constexpr bool is_digit(char ch) noexcept
+{
+    return static_cast<unsigned char>(ch - '0') < 10;
+}
+
+// -1 for anything that is not a hex digit
+constexpr int hex_value(char ch) noexcept
+{
+    if (is_digit(ch))
+        return ch - '0';
+    const auto lower{static_cast<unsigned char>(ch | 0x20)};
+    if (lower >= 'a' && lower <= 'f')
+        return lower - 'a' + 10;
+    return -1;
+}
+
+// Byte-by-byte validating parser, also used to diagnose the SIMD path errors.
+// Accepts exactly the language of IPaddress::IP_REGEX.
+constexpr ip_error parse_ipv4_scalar(std::string_view str,
+                                     uint32_t& out) noexcept
+{
+    if (str.empty())
+        return ip_error::empty;
+    if (str.size() > MAX_IPV4_LENGTH)
+        return ip_error::too_long;
+
+    uint32_t result{0};
+    size_t pos{0};
+    for (size_t octet{0}; octet < 4; ++octet)
+    {
+        if (octet > 0)
+        {
+            if (pos == str.size())
+                return ip_error::wrong_octet_count;
+            if (str[pos] != '.')
+                return ip_error::invalid_character;
+            ++pos;
+        }
+
+        const size_t start{pos};
+        uint32_t value{0};
+        while (pos < str.size() && is_digit(str[pos]))
+        {
+            if (pos - start == 3)
+                return ip_error::octet_out_of_range;
+            value = value * 10 + static_cast<uint32_t>(str[pos] - '0');
+            ++pos;
+        }
+
+        if (pos == start)
+        {
+            if (pos == str.size() || str[pos] == '.')
+                return ip_error::empty_octet;
+            return ip_error::invalid_character;
+        }
+        if (pos - start > 1 && str[start] == '0')
+            return ip_error::leading_zero;
+        if (value > 255)
+            return ip_error::octet_out_of_range;
+
+        result = result << 8 | value;
+    }
+
+    if (pos != str.size())
+        return str[pos] == '.' ? ip_error::wrong_octet_count
+                               : ip_error::invalid_character;
+
+    out = result;
+    return ip_error::ok;
+}
+
+#ifdef IP_PARSER_SSE2
+// Classifies all 7..15 bytes at once: one compare finds the dots, one
+// saturating compare finds the digits. Any input that is not a well-formed
+// "d.d.d.d" shape is handed to the scalar parser to get a precise error.
+inline ip_error parse_ipv4_sse2(std::string_view str, uint32_t& out) noexcept
+{
+    const size_t size{str.size()};
+    if (size < MIN_IPV4_LENGTH || size > MAX_IPV4_LENGTH)
+        return parse_ipv4_scalar(str, out);
+
+    // Two overlapping fixed size loads instead of a variable length copy,
+    // the bytes past the end come out as zeros
+    const char* const data{str.data()};
+    uint64_t low{0}, high{0};
+    if (size >= 8)
+    {
+        std::memcpy(&low, data, 8);
+        std::memcpy(&high, data + size - 8, 8);
+        // in two steps, size 8 would shift by the full 64 bits
+        high = (high >> 8) >> (15 - size) * 8;
+    }
+    else
+    {
+        uint32_t head{0}, tail{0};
+        std::memcpy(&head, data, 4);
+        std::memcpy(&tail, data + 3, 4);
+        low = head | static_cast<uint64_t>(tail >> 8) << 32;
+    }
+
+    // zero padded so that a 3 digit read past the last octet stays inside
+    alignas(16) char buffer[32]{};
+    const __m128i input{_mm_set_epi64x(static_cast<int64_t>(high),
+                                       static_cast<int64_t>(low))};
+    _mm_store_si128(reinterpret_cast<__m128i*>(buffer), input);
+
+    const __m128i shifted{_mm_sub_epi8(input, _mm_set1_epi8('0'))};
+    const __m128i nine{_mm_set1_epi8(9)};
+    const uint32_t digit_mask{static_cast<uint32_t>(_mm_movemask_epi8(
+        _mm_cmpeq_epi8(_mm_max_epu8(shifted, nine), nine)))};
+    const uint32_t dot_mask{static_cast<uint32_t>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(input, _mm_set1_epi8('.'))))};
+
+    const uint32_t used_mask{(1u << size) - 1};
+    if ((digit_mask | dot_mask) != used_mask || std::popcount(dot_mask) != 3)
+        return parse_ipv4_scalar(str, out);
+
+    // positions of the three dots plus a virtual one past the end
+    std::array<uint32_t, 5> dots{};
+    dots[0] = static_cast<uint32_t>(-1);
+    uint32_t rest{dot_mask};
+    for (size_t i{1}; i < 4; ++i, rest &= rest - 1)
+        dots[i] = std::countr_zero(rest);
+    dots[4] = static_cast<uint32_t>(size);
+
+    // Octet lengths are data dependent, so instead of a digit loop every
+    // octet reads three digit slots and weights them by its length.
+    // Bytes past the octet get weight 0. Errors are collected in one flag.
+    static constexpr std::array<std::array<uint32_t, 3>, 4> weights{
+        {{0, 0, 0}, {1, 0, 0}, {10, 1, 0}, {100, 10, 1}}};
+
+    uint32_t result{0};
+    bool malformed{false};
+    for (size_t i{0}; i < 4; ++i)
+    {
+        const uint32_t start{dots[i] + 1};
+        const uint32_t length{dots[i + 1] - start};
+        const auto& weight{weights[std::min(length, 3u)]};
+
+        const auto digit{[&buffer](uint32_t pos)
+                         {
+                             return static_cast<uint32_t>(
+                                 static_cast<unsigned char>(buffer[pos]) - '0');
+                         }};
+        const uint32_t first{digit(start)};
+        const uint32_t value{first * weight[0] + digit(start + 1) * weight[1] +
+                             digit(start + 2) * weight[2]};
+
+        malformed |= (length - 1 > 2) | ((length > 1) & (first == 0)) |
+                     (value > 255);
+        result = result << 8 | (value & 0xFF);
+    }
+
+    if (malformed)
+        return parse_ipv4_scalar(str, out);
+
+    out = result;
+    return ip_error::ok;
+}
+#endif
+
+// Decimal text of every octet padded to 4 bytes, the length is in the last
+// byte. Copying all 4 bytes at once avoids a branch per digit.
+constexpr std::array<std::array<char, 4>, 256> make_octet_digits() noexcept
+{
+    std::array<std::array<char, 4>, 256> table{};
+    for (unsigned i{0}; i < 256; ++i)
+    {
+        auto& entry{table[i]};
+        char length{0};
+        if (i >= 100)
+            entry[length++] = static_cast<char>('0' + i / 100);
+        if (i >= 10)
+            entry[length++] = static_cast<char>('0' + i / 10 % 10);
+        entry[length++] = static_cast<char>('0' + i % 10);
+        entry[3] = length;
+    }
+    return table;
+}
+
+inline constexpr auto OCTET_DIGITS{make_octet_digits()};
+
+// May write up to 3 bytes past the returned pointer
+constexpr char* write_octet(char* first, uint32_t octet) noexcept
+{
+    const auto& entry{OCTET_DIGITS[octet & 0xFF]};
+    std::copy_n(entry.data(), 4, first);
+    return first + entry[3];
+}
+
+// Needs 16 bytes even though the text is at most 15 long
+constexpr char* format_ipv4(char* first, uint32_t value) noexcept
+{
+    first = write_octet(first, value >> 24);
+    *first++ = '.';
+    first = write_octet(first, value >> 16);
+    *first++ = '.';
+    first = write_octet(first, value >> 8);
+    *first++ = '.';
+    return write_octet(first, value);
+}
+
+constexpr ip_error parse_ipv4(std::string_view str, uint32_t& out) noexcept
+{
+    if (std::is_constant_evaluated())
+        return parse_ipv4_scalar(str, out);
+#ifdef IP_PARSER_SSE2
+    return parse_ipv4_sse2(str, out);
+#else
+    return parse_ipv4_scalar(str, out);
+#endif
+}
+
+// murmur3 finalizer, every input bit affects every output bit
+constexpr uint64_t mix(uint64_t value) noexcept
+{
+    value ^= value >> 33;
+    value *= 0xFF51AFD7ED558CCDull;
+    value ^= value >> 33;
+    value *= 0xC4CEB9FE1A85EC53ull;
+    value ^= value >> 33;
+    return value;
+}
+} // namespace ip_detail
+
+class IPaddress final
+{
+public:
+    // Octets in memory order a, b, c, d regardless of the host endianness.
+    // Public only because that makes IPaddress a structural type, usable as
+    // a template argument; use to_network() instead.
+    uint32_t m_network{0};
+
+private:
+    static constexpr auto IP_REGEX =
+        R"(((\d|1\d\d|25[0-5]|2[0-4]\d|[1-9]\d)\.){3}(1\d\d|25[0-5]|2[0-4]\d|[1-9]\d|\d))";
+
+    // compiles to a single bswap (or nothing on big endian hosts)
+    static constexpr uint32_t _swap_to_network(uint32_t value) noexcept
+    {
+        if constexpr (std::endian::native == std::endian::big)
+            return value;
+        else
+            return value >> 24 | (value >> 8 & 0x0000FF00u) |
+                   (value << 8 & 0x00FF0000u) | value << 24;
+    }
+
+public:
+    constexpr IPaddress(uint8_t oct3, uint8_t oct2, uint8_t oct1,
+                        uint8_t oct0) noexcept
+        : IPaddress{static_cast<uint32_t>(oct3) << 24 |
+                    static_cast<uint32_t>(oct2) << 16 |
+                    static_cast<uint32_t>(oct1) << 8 | oct0}
+    {
+    }
+
+    constexpr explicit IPaddress(uint32_t byte_view) noexcept
+        : m_network{_swap_to_network(byte_view)}
+    {
+    }
+
+    constexpr IPaddress() noexcept = default;
+
+    // value as stored in in_addr::s_addr
+    static constexpr IPaddress from_network(uint32_t network) noexcept
+    {
+        return IPaddress{_swap_to_network(network)};
+    }
+
+    constexpr uint32_t to_network() const noexcept { return m_network; }
+
+    // "255.255.255.255"
+    static constexpr size_t MAX_STRING_LENGTH = ip_detail::MAX_IPV4_LENGTH;
+    // to_chars scratch space, one byte more than the longest text
+    static constexpr size_t TO_CHARS_SIZE = 16;
+
+    // Returns the past-the-end pointer, buffer contents after it are
+    // unspecified
+    constexpr char*
+    to_chars(std::span<char, TO_CHARS_SIZE> buffer) const noexcept
+    {
+        return ip_detail::format_ipv4(buffer.data(), to_uint32());
+    }
+
+    // std::to_chars style for buffers of any size
+    constexpr std::to_chars_result to_chars(char* first,
+                                            char* last) const noexcept
+    {
+        char buffer[TO_CHARS_SIZE];
+        char* const end{to_chars(buffer)};
+        const auto length{end - buffer};
+        if (last - first < length)
+            return {last, std::errc::value_too_large};
+        return {std::copy(buffer, end, first), std::errc{}};
+    }
+
+    inline std::string to_string() const noexcept
+    {
+        char buffer[TO_CHARS_SIZE];
+        return {buffer, to_chars(buffer)};
+    }
+
+    constexpr uint32_t to_uint32() const noexcept
+    {
+        return _swap_to_network(m_network);
+    }
+
+    // index 0 is the last octet of the dotted form, only 2 low bits are used
+    constexpr uint8_t get_octet(size_t index) const noexcept
+    {
+        assert(index < 4);
+        return static_cast<uint8_t>(to_uint32() >> index * 8);
+    }
+
+    constexpr void set_octet(size_t index, uint8_t octet) noexcept
+    {
+        assert(index < 4);
+        const uint32_t shift{static_cast<uint32_t>(index) * 8};
+        *this = IPaddress{(to_uint32() & ~(0xFFu << shift)) |
+                          static_cast<uint32_t>(octet) << shift};
+    }
+
+    constexpr bool operator==(const IPaddress&) const noexcept = default;
+
+    constexpr auto operator<=>(const IPaddress& other) const noexcept
+    {
+        return to_uint32() <=> other.to_uint32();
+    }
+
+    inline operator std::string() const noexcept { return to_string(); }
+
+    constexpr operator uint32_t() const noexcept { return to_uint32(); }
+
+    static inline void validate_ip(const std::string& addr)
+    {
+        std::regex ip_regex{IP_REGEX};
+        if (!std::regex_match(addr, ip_regex))
+        {
+            throw std::invalid_argument{std::format(
+                "{}({}): bad ip address",
+                std::source_location::current().function_name(), addr)};
+        }
+    }
+
+    // Reference implementation, kept for differential testing of try_parse
+    static inline IPaddress create_IP(const std::string& addr)
+    {
+        PROBE_SCOPE("IPaddress::create_IP");
+        validate_ip(addr);
+
+        IPaddress result;
+        std::istringstream istr{addr};
+        std::string buffer;
+        for (int i{3}; i >= 0; --i)
+        {
+            std::getline(istr, buffer, '.');
+            result.set_octet(i, stoi(buffer));
+        }
+        return result;
+    }
+
+    // Single pass, allocation free. Leaves result untouched on error.
+    static constexpr ip_error try_parse(std::string_view addr,
+                                        IPaddress& result) noexcept
+    {
+        uint32_t value{0};
+        const ip_error error{ip_detail::parse_ipv4(addr, value)};
+        if (error == ip_error::ok)
+            result = IPaddress{value};
+        return error;
+    }
+
+    // Compile time only, a malformed address fails the build
+    static consteval IPaddress parse(std::string_view addr)
+    {
+        IPaddress result;
+        if (try_parse(addr, result) != ip_error::ok)
+            throw std::invalid_argument{"IPaddress::parse: bad ip address"};
+        return result;
+    }
+};
+
+namespace ip_literals
+{
+// "10.0.0.1"_ip
+consteval IPaddress operator""_ip(const char* addr, size_t length)
+{
+    return IPaddress::parse({addr, length});
+}
+} // namespace ip_literals
+
+// Writes straight into the output, only the empty format spec is accepted
+template <>
+struct std::formatter<IPaddress>
+{
+    template <class ParseContext>
+    constexpr auto parse(ParseContext& ctx)
+    {
+        if (ctx.begin() != ctx.end() && *ctx.begin() != '}')
+            throw std::format_error{"IPaddress takes no format spec"};
+        return ctx.begin();
+    }
+
+    template <class FormatContext>
+    auto format(const IPaddress& addr, FormatContext& ctx) const
+    {
+        char buffer[IPaddress::TO_CHARS_SIZE];
+        return std::copy(buffer, addr.to_chars(buffer), ctx.out());
+    }
+};
+
+// Mixed, so that neighbouring addresses spread over the buckets
+template <>
+struct std::hash<IPaddress>
+{
+    size_t operator()(const IPaddress& addr) const noexcept
+    {
+        return static_cast<size_t>(ip_detail::mix(addr.to_uint32()));
+    }
+};
+
+static_assert(sizeof(IPaddress) == 4);
+static_assert(std::is_trivially_copyable_v<IPaddress>);
+static_assert(IPaddress{192, 168, 0, 1}.to_uint32() == 0xC0A80001u);
+static_assert(IPaddress{0xC0A80001u}.get_octet(3) == 192);
+static_assert(IPaddress::parse("192.168.0.1") == IPaddress{192, 168, 0, 1});
+
+// addresses work as template arguments
+template <IPaddress Address>
+inline constexpr uint32_t ip_constant = Address.to_uint32();
+static_assert(ip_constant<IPaddress::parse("0.0.1.0")> == 256);
@@ -1,213 +1,584 @@
-#include <algorithm>
+#include "cidr.hpp"
+#include "ip_address.hpp"
+#include "ip_batch.hpp"
+#include "ip_set.hpp"
+#include "ipv6_address.hpp"
+#include "mapped_file.hpp"
+#include "probe.hpp"
+#include "timer.hpp"
 #include <array>
-#include <chrono>
 #include <cstdint>
 #include <format>
 #include <iomanip>
 #include <iostream>
+#include <iterator>
+#include <optional>
+#include <random>
 #include <ranges>
-#include <regex>
-#include <source_location>
-#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
 
-class Timer final
+inline std::ostream& operator<<(std::ostream& stream,
+                                const IPaddress& addr) noexcept
 {
-    using clock = std::chrono::steady_clock;
-    using time_point = std::chrono::steady_clock::time_point;
-    using duration = std::chrono::duration<double>;
+    char buffer[IPaddress::TO_CHARS_SIZE];
+    stream.write(buffer, addr.to_chars(buffer) - buffer);
+    return stream;
+}
 
-public:
-    template <class Callable, typename... Args>
-    inline void operator()(Callable&& func_object, Args&&... args) const
+inline std::ostream& operator<<(std::ostream& stream,
+                                const IPv6address& addr)
+{
+    char buffer[IPv6address::MAX_STRING_LENGTH];
+    stream.write(buffer, addr.to_chars(buffer) - buffer);
+    return stream;
+}
+
+template <typename Integer>
+inline void show_bits(Integer num)
+{
+    uint8_t offset{sizeof(Integer) * 8 - 1};
+    for (Integer mask{static_cast<Integer>(Integer{1} << offset)}, counter{1};
+         mask;
+         mask >>= 1, ++counter)
     {
-        time_point start{clock::now()};
-        func_object(std::forward<Args>(args)...);
-        duration time_passed{
-            std::chrono::duration_cast<duration>(clock::now() - start)};
+        std::cout << static_cast<bool>(num & mask);
 
-        std::clog << std::format("Time passed: {:.5}s\n", time_passed.count());
+        // every 8th bit and not last
+        if (counter % 8 == 0 && mask != 1)
+            std::cout << " |";
+        std::cout << ' ';
     }
+}
 
-    template <typename ReturnType, class Callable, typename... Args>
-    inline ReturnType operator()(Callable&& func_object, Args&&... args) const
-    {
-        time_point start{clock::now()};
-        ReturnType temp = func_object(std::forward<Args>(args)...);
-        duration time_passed{
-            std::chrono::duration_cast<duration>(clock::now() - start)};
+inline void show_bits(const IPaddress& addr) { show_bits(addr.to_uint32()); }
 
-        std::clog << std::format("Time passed: {:.5}s\n", time_passed.count());
+inline void show_bits(const IPv6address& addr)
+{
+    show_bits(addr.high());
+    std::cout << "| ";
+    show_bits(addr.low());
+}
 
-        return temp;
+inline void show_octets(const IPaddress& addr)
+{
+    for (int i{3}; i >= 0; --i)
+    {
+        std::cout << std::format("Octet {}: ({:>3}) ", i,
+                                 static_cast<uint16_t>(addr.get_octet(i)));
+        show_bits(addr.get_octet(i));
+        std::cout << '\n';
     }
-};
+}
 
-class IPaddress final
+inline void show_full(const IPaddress& addr)
 {
-private:
-    std::array<uint8_t, 4> octets{};
-    static constexpr auto IP_REGEX =
-        R"(((\d|1\d\d|25[0-5]|2[0-4]\d|[1-9]\d)\.){3}(1\d\d|25[0-5]|2[0-4]\d|[1-9]\d|\d))";
+    std::cout << std::format("Full address: ({}) ", addr.to_uint32());
+    show_bits(addr);
+}
 
-public:
-    IPaddress(uint8_t oct3, uint8_t oct2, uint8_t oct1, uint8_t oct0)
-    {
-        set_octet(0, oct0);
-        set_octet(1, oct1);
-        set_octet(2, oct2);
-        set_octet(3, oct3);
-    };
+inline void describe_IP(const IPaddress& addr)
+{
+    std::cout << addr << (is_private(addr) ? " (private)\n" : "\n");
+    show_octets(addr);
+
+    show_full(addr);
+    std::cout << '\n';
+}
 
-    explicit IPaddress(uint32_t byte_view)
+inline void show_hextets(const IPv6address& addr)
+{
+    for (int i{7}; i >= 0; --i)
     {
-        uint8_t current_octet{0};
-        for (size_t i{0}; i < 4; ++i)
-            std::ranges::for_each(
-                std::views::iota(0, 4), [this, current_octet, byte_view](auto i)
-                { set_octet(i, current_octet | byte_view >> i * 8); });
+        std::cout << std::format("Hextet {}: ({:04x}) ", i,
+                                 addr.get_hextet(i));
+        show_bits(addr.get_hextet(i));
+        std::cout << '\n';
     }
+}
 
-    IPaddress() = default;
-    IPaddress(const IPaddress&) = default;
-    IPaddress(IPaddress&&) noexcept = default;
-    IPaddress& operator=(const IPaddress&) = default;
-    IPaddress& operator=(IPaddress&&) noexcept = default;
-    ~IPaddress() = default;
+inline void show_full(const IPv6address& addr)
+{
+    std::cout << std::format("Full address: ({:016x}{:016x})\n", addr.high(),
+                             addr.low());
+    show_bits(addr);
+}
 
-    inline std::string to_string() const noexcept
-    {
-        return std::format("{}.{}.{}.{}", get_octet(3), get_octet(2),
-                           get_octet(1), get_octet(0));
-    }
+inline void describe_IP(const IPv6address& addr, std::string_view zone = {})
+{
+    std::cout << addr;
+    if (!zone.empty())
+        std::cout << '%' << zone;
+    std::cout << '\n';
+    if (addr.is_v4_mapped())
+        std::cout << std::format("IPv4-mapped: {}\n", addr.to_v4());
+    show_hextets(addr);
 
-    inline uint32_t to_uint32() const noexcept
-    {
-        uint32_t result{0};
-        for (int i{3}; i >= 0; --i)
-        {
-            result |= get_octet(i);
-            if (i > 0)
-                result <<= 8;
-        }
+    show_full(addr);
+    std::cout << '\n';
+}
 
+// Generates addresses that are valid, almost valid and garbage
+inline std::string random_ip_candidate(std::mt19937& gen)
+{
+    static constexpr std::string_view alphabet{"0123456789.0123456789.a -"};
+    std::uniform_int_distribution<int> kind(0, 4), octet(0, 255),
+        length(0, 17), symbol(0, alphabet.size() - 1);
+
+    switch (kind(gen))
+    {
+    case 0:
+        return std::format("{}.{}.{}.{}", octet(gen), octet(gen), octet(gen),
+                           octet(gen));
+    case 1:
+    {
+        std::string result{std::format("{}.{}.{}.{}", octet(gen), octet(gen),
+                                       octet(gen), octet(gen))};
+        std::uniform_int_distribution<size_t> position(0, result.size() - 1);
+        result[position(gen)] = alphabet[symbol(gen)];
         return result;
     }
-
-    inline uint8_t get_octet(size_t index) const noexcept
+    case 2:
+        return std::format("{}.{}.{}.{}", octet(gen) * 4, octet(gen),
+                           octet(gen) % 10, octet(gen) * 11);
+    case 3:
     {
-        return octets.at(index);
+        // exactly 8 characters, where the SSE2 loads just meet
+        std::array<int, 4> octets{octet(gen) % 10, octet(gen) % 10,
+                                  octet(gen) % 10, octet(gen) % 10};
+        octets[octet(gen) % 4] = octet(gen) % 90 + 10;
+        return std::format("{}.{}.{}.{}", octets[0], octets[1], octets[2],
+                           octets[3]);
     }
-
-    inline void set_octet(size_t index, uint8_t octet)
+    default:
     {
-        octets.at(index) = octet;
+        std::string result(length(gen), '\0');
+        for (auto& ch : result)
+            ch = alphabet[symbol(gen)];
+        return result;
     }
+    }
+}
 
-    inline operator std::string() const noexcept { return to_string(); }
-
-    inline operator uint32_t() const noexcept { return to_uint32(); }
+// Compares try_parse against the regex based create_IP
+inline bool differential_check(size_t iterations)
+{
+    std::mt19937 gen{std::random_device{}()};
+    size_t mismatches{0}, valid{0};
 
-    static inline void validate_ip(const std::string& addr)
+    for (size_t i{0}; i < iterations; ++i)
     {
-        std::regex ip_regex{IP_REGEX};
-        if (!std::regex_match(addr, ip_regex))
+        const std::string candidate{random_ip_candidate(gen)};
+
+        bool reference_ok{true};
+        IPaddress reference;
+        try
         {
-            throw std::invalid_argument{std::format(
-                "{}({}): bad ip address",
-                std::source_location::current().function_name(), addr)};
+            reference = IPaddress::create_IP(candidate);
+        }
+        catch (const std::exception&)
+        {
+            reference_ok = false;
         }
-    }
 
-    static inline IPaddress create_IP(const std::string& addr)
-    {
-        validate_ip(addr);
+        IPaddress fast;
+        const ip_error error{IPaddress::try_parse(candidate, fast)};
+        uint32_t scalar_value{0};
+        const ip_error scalar_error{
+            ip_detail::parse_ipv4_scalar(candidate, scalar_value)};
 
-        IPaddress result;
-        std::istringstream istr{addr};
-        std::string buffer;
-        for (int i{3}; i >= 0; --i)
+        const bool fast_ok{error == ip_error::ok};
+        if (fast_ok != reference_ok || error != scalar_error ||
+            (fast_ok && (fast.to_uint32() != reference.to_uint32() ||
+                         scalar_value != reference.to_uint32())))
         {
-            std::getline(istr, buffer, '.');
-            result.set_octet(i, stoi(buffer));
+            ++mismatches;
+            std::cerr << std::format("Mismatch on \"{}\": reference {}, "
+                                     "try_parse {}, scalar {}\n",
+                                     candidate, reference_ok, to_string(error),
+                                     to_string(scalar_error));
         }
-        return result;
+        valid += reference_ok;
     }
-};
 
-inline std::ostream& operator<<(std::ostream& stream,
-                                const IPaddress& addr) noexcept
-{
-    stream << addr.to_string();
-    return stream;
+    std::cout << std::format("Checked {} inputs ({} valid), {} mismatches\n",
+                             iterations, valid, mismatches);
+    return mismatches == 0;
 }
 
-template <typename Integer>
-inline void show_bits(Integer num)
+// Parses a whole file ("-" for stdin) of addresses, one per line
+inline void parse_file(const std::string& path, unsigned threads)
 {
-    uint8_t offset{sizeof(Integer) * 8 - 1};
-    for (Integer mask{static_cast<Integer>(1 << offset)}, counter{1}; mask;
-         mask >>= 1, ++counter)
+    std::string input;
+    std::optional<mapped_file> file;
+    std::string_view buffer;
+    if (path == "-")
     {
-        std::cout << static_cast<bool>(num & mask);
-
-        // every 8th bit and not last
-        if (counter % 8 == 0 && mask != 1)
-            std::cout << " |";
-        std::cout << ' ';
+        input.assign(std::istreambuf_iterator<char>{std::cin}, {});
+        buffer = input;
     }
+    else
+        buffer = file.emplace(path).view();
+
+    const size_t lines{ip_batch::count_lines(buffer)};
+    std::vector<uint32_t> addresses(lines);
+    std::vector<uint64_t> valid_bitmap(ip_batch::bitmap_words(lines));
+    size_t valid{0};
+
+    const double seconds{Timer{}.seconds(
+        [&]
+        {
+            valid = ip_batch::parse(buffer, addresses, valid_bitmap, threads);
+        })};
+
+    std::cout << std::format("Lines: {}, valid: {}, invalid: {}\n", lines,
+                             valid, lines - valid);
+    std::cout << std::format(
+        "Time: {:.5}s, {:.4} lines/s, {:.4} GB/s ({} threads)\n", seconds,
+        lines / seconds, buffer.size() / seconds / 1e9, threads);
+
+    std::vector<char> output(lines * ip_batch::FORMAT_LINE_SIZE);
+    size_t written{0};
+    const double format_seconds{Timer{}.seconds(
+        [&] { written = ip_batch::format(addresses, output); })};
+    std::cout << std::format("Format: {:.5}s, {:.4} lines/s, {:.4} GB/s\n",
+                             format_seconds, lines / format_seconds,
+                             written / format_seconds / 1e9);
 }
 
-inline void show_octets(const IPaddress& addr)
+// Random rules with a realistic prefix mix, most between /16 and /24
+inline std::vector<CIDR> random_rules(std::mt19937& gen, size_t count)
 {
-    for (int i{3}; i >= 0; --i)
+    std::uniform_int_distribution<uint32_t> address;
+    std::discrete_distribution<int> prefix{
+        {0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 0, 0, 1, 1, 1, 1, 6, 2, 2, 3,
+         4, 4, 5, 5, 30, 2, 2, 2, 2, 2, 2, 2, 4}};
+
+    std::vector<CIDR> rules;
+    rules.reserve(count);
+    for (size_t i{0}; i < count; ++i)
+        rules.emplace_back(IPaddress{address(gen)},
+                           static_cast<uint8_t>(prefix(gen)));
+    return rules;
+}
+
+// Compares lpm_table against a linear scan over the same rules
+inline bool cidr_benchmark(size_t rule_count, size_t lookup_count)
+{
+    std::mt19937 gen{std::random_device{}()};
+    const std::vector<CIDR> rules{random_rules(gen, rule_count)};
+
+    // half of the addresses fall inside some rule
+    std::uniform_int_distribution<uint32_t> address;
+    std::uniform_int_distribution<size_t> rule_index(0, rules.size() - 1);
+    std::vector<IPaddress> addresses(lookup_count);
+    for (size_t i{0}; i < lookup_count; ++i)
     {
-        std::cout << std::format("Octet {}: ({:>3}) ", i,
-                                 static_cast<uint16_t>(addr.get_octet(i)));
-        show_bits(addr.get_octet(i));
-        std::cout << '\n';
+        const CIDR& rule{rules[rule_index(gen)]};
+        const uint32_t host{address(gen) & ~CIDR::mask(rule.prefix())};
+        addresses[i] = i % 2 ? IPaddress{address(gen)}
+                             : IPaddress{rule.network().to_uint32() | host};
     }
+
+    Timer measure;
+    std::optional<lpm_table> table;
+    const double build_time{measure.seconds([&] { table.emplace(rules); })};
+
+    std::vector<uint32_t> fast(lookup_count), batch(lookup_count),
+        linear(lookup_count);
+    const double single_time{measure.seconds(
+        [&]
+        {
+            for (size_t i{0}; i < lookup_count; ++i)
+                fast[i] = table->lookup(addresses[i]);
+        })};
+    const double batch_time{
+        measure.seconds([&] { table->lookup(addresses, batch); })};
+    const double linear_time{measure.seconds(
+        [&]
+        {
+            for (size_t i{0}; i < lookup_count; ++i)
+                linear[i] = linear_lookup(rules, addresses[i]);
+        })};
+
+    const auto mismatches{std::ranges::count_if(
+        std::views::iota(size_t{0}, lookup_count), [&](size_t i)
+        { return fast[i] != linear[i] || batch[i] != linear[i]; })};
+    const auto matched{std::ranges::count_if(
+        linear, [](uint32_t rule) { return rule != lpm_table::NO_MATCH; })};
+
+    std::cout << std::format("Rules: {}, lookups: {} ({} matched)\n",
+                             rule_count, lookup_count, matched);
+    std::cout << std::format("Table build: {:.5}s, {} MiB\n", build_time,
+                             table->memory_usage() >> 20);
+    const auto report{[lookup_count](std::string_view name, double seconds)
+                      {
+                          std::cout << std::format(
+                              "{:<16}{:.5}s, {:.1f} ns/lookup\n", name,
+                              seconds, seconds * 1e9 / lookup_count);
+                      }};
+    report("DIR-24-8:", single_time);
+    report("DIR-24-8 batch:", batch_time);
+    report("Linear scan:", linear_time);
+    std::cout << std::format("Mismatches: {}\n", mismatches);
+
+    return mismatches == 0;
 }
 
-inline void show_full(const IPaddress& addr)
+// Deduplicates the same stream with ip_set and std::unordered_set, once
+// spread over the whole address space and once packed into 10.0.0.0/8
+inline bool set_benchmark(size_t count)
 {
-    std::cout << std::format("Full address: ({}) ", addr.to_uint32());
-    show_bits(addr.to_uint32());
+    std::mt19937 gen{42};
+    // about half of the stream is repeats
+    std::uniform_int_distribution<uint32_t> pick(0, count / 2);
+    const auto make_stream{[&](uint32_t base, uint32_t spread)
+                           {
+                               std::vector<IPaddress> stream(count);
+                               for (auto& addr : stream)
+                                   addr = IPaddress{
+                                       base + static_cast<uint32_t>(
+                                                  ip_detail::mix(pick(gen)) %
+                                                  spread)};
+                               return stream;
+                           }};
+
+    Timer measure;
+    bool same{true};
+    const auto run{[&](std::string_view name,
+                       const std::vector<IPaddress>& stream)
+                   {
+                       ip_set fast;
+                       std::unordered_set<IPaddress> reference;
+                       size_t fast_new{0}, reference_new{0};
+                       const double fast_time{measure.seconds(
+                           [&]
+                           {
+                               for (const IPaddress addr : stream)
+                                   fast_new += fast.insert(addr);
+                           })};
+                       const double reference_time{measure.seconds(
+                           [&]
+                           {
+                               for (const IPaddress addr : stream)
+                                   reference_new +=
+                                       reference.insert(addr).second;
+                           })};
+
+                       size_t fast_hits{0}, reference_hits{0};
+                       const double fast_lookup{measure.seconds(
+                           [&]
+                           {
+                               for (const IPaddress addr : stream)
+                                   fast_hits += fast.contains(
+                                       IPaddress{addr.to_uint32() ^ 1});
+                           })};
+                       const double reference_lookup{measure.seconds(
+                           [&]
+                           {
+                               for (const IPaddress addr : stream)
+                                   reference_hits += reference.contains(
+                                       IPaddress{addr.to_uint32() ^ 1});
+                           })};
+
+                       size_t listed{0};
+                       fast.for_each([&](IPaddress addr)
+                                     { listed += reference.contains(addr); });
+                       same = same && fast_new == reference_new &&
+                              fast_hits == reference_hits &&
+                              listed == reference.size() &&
+                              fast.size() == reference.size() &&
+                              fast.dense_size() <= fast.size();
+
+                       const auto per_item{[&](double seconds)
+                                           { return seconds * 1e9 / count; }};
+                       std::cout << std::format(
+                           "{}: {} inserts, {} unique, ip_set {} MiB\n", name,
+                           count, fast.size(), fast.memory_usage() >> 20);
+                       std::cout << std::format(
+                           "  insert   ip_set {:.1f} ns, unordered_set "
+                           "{:.1f} ns\n",
+                           per_item(fast_time), per_item(reference_time));
+                       std::cout << std::format(
+                           "  contains ip_set {:.1f} ns, unordered_set "
+                           "{:.1f} ns\n",
+                           per_item(fast_lookup), per_item(reference_lookup));
+                   }};
+
+    run("Sparse", make_stream(0, UINT32_MAX));
+    run("Dense 10/8", make_stream(IPaddress::parse("10.0.0.0").to_uint32(),
+                                  1u << 24));
+    std::cout << (same ? "Results match\n" : "Results DIFFER\n");
+    return same;
 }
 
-inline void describe_IP(const IPaddress& addr)
+// Compares the parser variants on a rotating pool of addresses
+inline void parser_benchmark(bool json)
 {
-    std::cout << addr << '\n';
-    show_octets(addr);
+    std::mt19937 gen{42};
+    std::vector<std::string> pool(1024);
+    for (auto& candidate : pool)
+        candidate = random_ip_candidate(gen);
 
-    show_full(addr);
-    std::cout << '\n';
+    size_t next{0};
+    const auto input{[&]() -> const std::string&
+                     { return pool[next++ % pool.size()]; }};
+
+    Timer measure;
+    std::vector<benchmark_result> results;
+    results.push_back(measure.benchmark(
+        "create_IP (regex)",
+        [&]
+        {
+            try
+            {
+                return IPaddress::create_IP(input()).to_uint32();
+            }
+            catch (const std::invalid_argument&)
+            {
+                return uint32_t{0};
+            }
+        }));
+    results.push_back(measure.benchmark(
+        "parse_ipv4_scalar",
+        [&]
+        {
+            uint32_t value{0};
+            return ip_detail::parse_ipv4_scalar(input(), value) ==
+                           ip_error::ok
+                       ? value
+                       : 0;
+        }));
+#ifdef IP_PARSER_SSE2
+    results.push_back(measure.benchmark(
+        "parse_ipv4_sse2",
+        [&]
+        {
+            uint32_t value{0};
+            return ip_detail::parse_ipv4_sse2(input(), value) == ip_error::ok
+                       ? value
+                       : 0;
+        }));
+#endif
+    results.push_back(measure.benchmark(
+        "IPaddress::try_parse",
+        [&]
+        {
+            IPaddress addr;
+            IPaddress::try_parse(input(), addr);
+            return addr;
+        }));
+
+    uint32_t value{0};
+    results.push_back(measure.benchmark(
+        "IPaddress::to_chars",
+        [&]
+        {
+            char buffer[IPaddress::TO_CHARS_SIZE];
+            IPaddress{value += 0x01010101}.to_chars(buffer);
+            do_not_optimize(buffer);
+        }));
+    results.push_back(measure.benchmark(
+        "IPaddress::to_string",
+        [&] { return IPaddress{value += 0x01010101}.to_string(); }));
+
+    if (json)
+    {
+        std::cout << "[\n";
+        for (size_t i{0}; i < results.size(); ++i)
+            std::cout << std::format("  {}{}\n", results[i].to_json(),
+                                     i + 1 < results.size() ? "," : "");
+        std::cout << "]\n";
+        return;
+    }
+
+    std::cout << benchmark_result::header() << '\n';
+    for (const auto& result : results)
+        std::cout << result.to_string() << '\n';
 }
 
 int main(int argc, char* argv[])
 {
+    probe::install();
+
+    if (argc > 1 && std::string_view{argv[1]} == "--bench")
+    {
+        parser_benchmark(argc > 2 && std::string_view{argv[2]} == "--json");
+        return EXIT_SUCCESS;
+    }
+
+    if (argc > 1 && std::string_view{argv[1]} == "--cidr-bench")
+    {
+        const size_t rules{argc > 2 ? std::stoul(argv[2]) : 20'000ul};
+        const size_t lookups{argc > 3 ? std::stoul(argv[3]) : 50'000ul};
+        return cidr_benchmark(std::max(rules, size_t{1}), lookups)
+                   ? EXIT_SUCCESS
+                   : EXIT_FAILURE;
+    }
+
+    if (argc > 1 && std::string_view{argv[1]} == "--set-bench")
+    {
+        const size_t count{argc > 2 ? std::stoul(argv[2]) : 2'000'000ul};
+        return set_benchmark(std::max(count, size_t{2})) ? EXIT_SUCCESS
+                                                         : EXIT_FAILURE;
+    }
+
+    if (argc > 2 && std::string_view{argv[1]} == "--batch")
+    {
+        const unsigned threads{
+            argc > 3 ? static_cast<unsigned>(std::stoul(argv[3]))
+                     : std::max(std::thread::hardware_concurrency(), 1u)};
+        try
+        {
+            parse_file(argv[2], threads);
+        }
+        catch (const std::exception& ex)
+        {
+            std::cerr << std::format("{}\n", ex.what());
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+
+    if (argc > 1 && std::string_view{argv[1]} == "--check")
+    {
+        const size_t iterations{argc > 2 ? std::stoul(argv[2]) : 10'000ul};
+        return differential_check(iterations) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
     Timer measure;
     IPaddress addr;
+    IPv6address addr6;
+    std::string_view zone;
     std::string input;
 
     while (true)
     {
         std::cout << "Enter IP address (or type \"exit\"): ";
-        std::getline(std::cin, input, '\n');
-        if (input == "exit")
+        if (!std::getline(std::cin, input, '\n') || input == "exit")
         {
             std::cout << "Exited by user\n";
             break;
         }
 
-        try
-        {
-            addr = measure.operator()<IPaddress>(IPaddress::create_IP, input);
-            describe_IP(addr);
-        }
-        catch (const std::exception& e)
+        const bool is_v6{input.find(':') != std::string::npos};
+        const ip_error error{
+            is_v6 ? measure.operator()<ip_error>(IPv6address::try_parse, input,
+                                                 addr6, &zone)
+                  : measure.operator()<ip_error>(IPaddress::try_parse, input,
+                                                 addr)};
+        if (error == ip_error::ok)
         {
-            std::cerr << e.what() << '\n';
+            if (is_v6)
+                describe_IP(addr6, zone);
+            else
+                describe_IP(addr);
         }
+        else
+            std::cerr << std::format("{}: bad ip address ({})\n", input,
+                                     to_string(error));
     };
 
     return EXIT_SUCCESS;
@@ -0,0 +1,172 @@
+#pragma once
+
+#include "ip_address.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <span>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Batch parsing of newline separated IPv4 addresses. Line i of the buffer
+// goes to addresses[i] (0 when invalid) and to bit i % 64 of
+// valid_bitmap[i / 64]. "\r\n" line endings are accepted.
+namespace ip_batch
+{
+// Chunks smaller than this are not worth a thread
+inline constexpr size_t MIN_CHUNK_SIZE = 1 << 16;
+// Output space format() needs per address
+inline constexpr size_t FORMAT_LINE_SIZE = IPaddress::TO_CHARS_SIZE;
+
+inline size_t count_lines(std::string_view buffer) noexcept
+{
+    if (buffer.empty())
+        return 0;
+
+    const auto newlines{static_cast<size_t>(
+        std::count(buffer.begin(), buffer.end(), '\n'))};
+    return buffer.back() == '\n' ? newlines : newlines + 1;
+}
+
+constexpr size_t bitmap_words(size_t lines) noexcept
+{
+    return (lines + 63) / 64;
+}
+
+constexpr bool is_valid(std::span<const uint64_t> valid_bitmap,
+                        size_t line) noexcept
+{
+    return valid_bitmap[line / 64] >> (line % 64) & 1;
+}
+
+// Parses every line of buffer, numbering them from first_line.
+// The bitmap must be zeroed; bits are or-ed in one word at a time, so
+// neighbouring chunks may share a word. Returns the number of valid lines.
+inline size_t parse_lines(std::string_view buffer, uint32_t* addresses,
+                          uint64_t* valid_bitmap, size_t first_line) noexcept
+{
+    size_t line{first_line}, valid{0};
+    uint64_t word{0};
+    const auto flush{[&](size_t last_line)
+                     {
+                         if (word != 0)
+                             std::atomic_ref<uint64_t>{
+                                 valid_bitmap[last_line / 64]}
+                                 .fetch_or(word, std::memory_order_relaxed);
+                         word = 0;
+                     }};
+
+    const char* pos{buffer.data()};
+    const char* const end{pos + buffer.size()};
+    while (pos < end)
+    {
+        const char* eol{static_cast<const char*>(
+            std::memchr(pos, '\n', static_cast<size_t>(end - pos)))};
+        if (eol == nullptr)
+            eol = end;
+
+        std::string_view text{pos, static_cast<size_t>(eol - pos)};
+        if (!text.empty() && text.back() == '\r')
+            text.remove_suffix(1);
+
+        uint32_t value{0};
+        const bool ok{ip_detail::parse_ipv4(text, value) == ip_error::ok};
+        addresses[line] = ok ? value : 0;
+        word |= uint64_t{ok} << (line % 64);
+        valid += ok;
+
+        if (++line % 64 == 0)
+            flush(line - 1);
+        pos = eol + 1;
+    }
+    flush(line - 1);
+
+    return valid;
+}
+
+// Splits buffer into at most parts pieces, each ending on a line boundary
+inline std::vector<std::string_view> split_lines(std::string_view buffer,
+                                                 size_t parts)
+{
+    std::vector<std::string_view> chunks;
+    const size_t target{std::max(buffer.size() / std::max(parts, size_t{1}),
+                                 MIN_CHUNK_SIZE)};
+
+    while (!buffer.empty())
+    {
+        size_t cut{std::min(target, buffer.size())};
+        const size_t newline{buffer.find('\n', cut - 1)};
+        cut = newline == std::string_view::npos ? buffer.size() : newline + 1;
+
+        chunks.push_back(buffer.substr(0, cut));
+        buffer.remove_prefix(cut);
+    }
+    return chunks;
+}
+
+// addresses must hold count_lines(buffer) elements and valid_bitmap
+// bitmap_words() of that. With threads > 1 the buffer is cut on line
+// boundaries, lines are counted per chunk to find each chunk's first index,
+// then the chunks are parsed concurrently.
+inline size_t parse(std::string_view buffer, std::span<uint32_t> addresses,
+                    std::span<uint64_t> valid_bitmap, unsigned threads = 1)
+{
+    std::ranges::fill(valid_bitmap, 0);
+
+    const std::vector<std::string_view> chunks{split_lines(buffer, threads)};
+    if (chunks.size() <= 1)
+    {
+        assert(addresses.size() >= count_lines(buffer));
+        assert(valid_bitmap.size() >= bitmap_words(addresses.size()));
+        return parse_lines(buffer, addresses.data(), valid_bitmap.data(), 0);
+    }
+
+    std::vector<size_t> first_line(chunks.size()), valid(chunks.size());
+    const auto run_per_chunk{[&chunks](auto&& task)
+                             {
+                                 std::vector<std::jthread> workers;
+                                 workers.reserve(chunks.size());
+                                 for (size_t i{0}; i < chunks.size(); ++i)
+                                     workers.emplace_back(task, i);
+                             }};
+
+    run_per_chunk([&](size_t i) { first_line[i] = count_lines(chunks[i]); });
+    const size_t total{std::accumulate(first_line.begin(), first_line.end(),
+                                       size_t{0})};
+    std::exclusive_scan(first_line.begin(), first_line.end(),
+                        first_line.begin(), size_t{0});
+
+    assert(addresses.size() >= total);
+    assert(valid_bitmap.size() >= bitmap_words(total));
+    (void)total;
+
+    run_per_chunk(
+        [&](size_t i)
+        {
+            valid[i] = parse_lines(chunks[i], addresses.data(),
+                                   valid_bitmap.data(), first_line[i]);
+        });
+
+    return std::accumulate(valid.begin(), valid.end(), size_t{0});
+}
+
+// Writes one address per line, output must hold
+// addresses.size() * FORMAT_LINE_SIZE bytes. Returns the bytes written.
+inline size_t format(std::span<const uint32_t> addresses,
+                     std::span<char> output) noexcept
+{
+    assert(output.size() >= addresses.size() * FORMAT_LINE_SIZE);
+
+    char* pos{output.data()};
+    for (const uint32_t address : addresses)
+    {
+        pos = ip_detail::format_ipv4(pos, address);
+        *pos++ = '\n';
+    }
+    return static_cast<size_t>(pos - output.data());
+}
+} // namespace ip_batch
@@ -0,0 +1,293 @@
+#pragma once
+
+#include "ip_address.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Open addressing set of IPv4 addresses in the Swiss table layout: slots
+// come in groups of 16 with one control byte each, holding 7 bits of the
+// hash for a used slot or a negative EMPTY / DELETED marker. A probe
+// compares the whole group of control bytes at once and only touches the
+// slots whose hash bits match.
+// A /8 holding DENSE_THRESHOLD addresses moves out of the table into a
+// 2 MiB bitmap of its own, which is smaller than the slots it frees and
+// needs no probing.
+class ip_set final
+{
+public:
+    static constexpr size_t GROUP_SIZE = 16;
+    // a /8 bitmap weighs as much as this many slots
+    static constexpr size_t DENSE_THRESHOLD = (size_t{1} << 21) / 5;
+
+    ip_set() = default;
+    ip_set(ip_set&&) noexcept = default;
+    ip_set& operator=(ip_set&&) noexcept = default;
+
+    explicit ip_set(size_t expected) { reserve(expected); }
+
+    size_t size() const noexcept { return m_size; }
+    bool empty() const noexcept { return m_size == 0; }
+    // elements held by /8 bitmaps rather than the table
+    size_t dense_size() const noexcept { return m_dense_size; }
+
+    // Sizes the table for expected addresses without regrowing
+    void reserve(size_t expected)
+    {
+        const size_t needed{expected + expected / 7 + 1};
+        if (needed > _max_load())
+            _rehash(std::bit_ceil(std::max(needed, GROUP_SIZE)));
+    }
+
+    bool contains(IPaddress addr) const noexcept
+    {
+        const uint32_t value{addr.to_uint32()};
+        if (const uint64_t* bits{m_dense[value >> 24].get()})
+            return _test(bits, value);
+        return _find(value) != NPOS;
+    }
+
+    // Returns true when addr was not in the set yet
+    bool insert(IPaddress addr)
+    {
+        const uint32_t value{addr.to_uint32()};
+        if (uint64_t* bits{m_dense[value >> 24].get()})
+        {
+            const bool added{!_test(bits, value)};
+            bits[(value & 0xFFFFFF) / 64] |= uint64_t{1} << (value % 64);
+            m_size += added;
+            m_dense_size += added;
+            return added;
+        }
+        if (_find(value) != NPOS)
+            return false;
+
+        const size_t live{m_size - m_dense_size};
+        if (live + m_deleted + 1 > _max_load())
+        {
+            // mostly tombstones: clean up in place instead of growing
+            const bool grow{live + 1 > m_slots.size() / 2};
+            _rehash(grow ? std::max(m_slots.size() * 2, GROUP_SIZE)
+                         : m_slots.size());
+        }
+        _emplace(value);
+        ++m_size;
+
+        if (++m_counts[value >> 24] >= DENSE_THRESHOLD)
+            _make_dense(value >> 24);
+        return true;
+    }
+
+    // Returns true when addr was in the set
+    bool erase(IPaddress addr) noexcept
+    {
+        const uint32_t value{addr.to_uint32()};
+        if (uint64_t* bits{m_dense[value >> 24].get()})
+        {
+            const bool removed{_test(bits, value)};
+            bits[(value & 0xFFFFFF) / 64] &= ~(uint64_t{1} << (value % 64));
+            m_size -= removed;
+            m_dense_size -= removed;
+            return removed;
+        }
+
+        const size_t slot{_find(value)};
+        if (slot == NPOS)
+            return false;
+        m_control[slot] = DELETED;
+        ++m_deleted;
+        --m_size;
+        --m_counts[value >> 24];
+        return true;
+    }
+
+    void clear() noexcept
+    {
+        std::ranges::fill(m_control, EMPTY);
+        for (auto& bits : m_dense)
+            bits.reset();
+        m_counts = {};
+        m_size = m_dense_size = m_deleted = 0;
+    }
+
+    // Calls func(IPaddress) for every element, in no particular order
+    template <class Callable>
+    void for_each(Callable&& func) const
+    {
+        for (size_t slot{0}; slot < m_slots.size(); ++slot)
+            if (m_control[slot] >= 0)
+                func(IPaddress{m_slots[slot]});
+
+        for (uint32_t top{0}; top < 256; ++top)
+        {
+            const uint64_t* bits{m_dense[top].get()};
+            for (size_t word{0}; bits != nullptr && word < DENSE_WORDS;
+                 ++word)
+                for (uint64_t rest{bits[word]}; rest != 0; rest &= rest - 1)
+                    func(IPaddress{top << 24 | static_cast<uint32_t>(
+                                                   word * 64 +
+                                                   std::countr_zero(rest))});
+        }
+    }
+
+    size_t memory_usage() const noexcept
+    {
+        const auto dense{static_cast<size_t>(std::ranges::count_if(
+            m_dense, [](const auto& bits) { return bits != nullptr; }))};
+        return m_slots.size() * (sizeof(uint32_t) + 1) +
+               dense * DENSE_WORDS * sizeof(uint64_t);
+    }
+
+private:
+    ip_set(const ip_set&) = delete;
+    ip_set& operator=(const ip_set&) = delete;
+
+    static constexpr int8_t EMPTY = -128;
+    static constexpr int8_t DELETED = -2;
+    static constexpr size_t NPOS = SIZE_MAX;
+    static constexpr size_t DENSE_WORDS = (size_t{1} << 24) / 64;
+
+    // control bytes and slots run in parallel, the size is a power of two
+    std::vector<int8_t> m_control;
+    std::vector<uint32_t> m_slots;
+    // addresses per /8 living in the table, decides when to go dense
+    std::array<uint32_t, 256> m_counts{};
+    std::array<std::unique_ptr<uint64_t[]>, 256> m_dense;
+    size_t m_size{0};
+    size_t m_dense_size{0};
+    size_t m_deleted{0};
+
+    // 7/8 of the slots, counting tombstones
+    size_t _max_load() const noexcept
+    {
+        return m_slots.size() - m_slots.size() / 8;
+    }
+
+    static bool _test(const uint64_t* bits, uint32_t value) noexcept
+    {
+        return bits[(value & 0xFFFFFF) / 64] >> (value % 64) & 1;
+    }
+
+    // bit i set where control[i] == byte
+    static uint32_t _match(const int8_t* control, int8_t byte) noexcept
+    {
+#ifdef IP_PARSER_SSE2
+        const __m128i group{
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(control))};
+        return static_cast<uint32_t>(
+            _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(byte))));
+#else
+        uint32_t mask{0};
+        for (size_t i{0}; i < GROUP_SIZE; ++i)
+            mask |= uint32_t{control[i] == byte} << i;
+        return mask;
+#endif
+    }
+
+    // bit i set where slot i is EMPTY or DELETED
+    static uint32_t _match_free(const int8_t* control) noexcept
+    {
+#ifdef IP_PARSER_SSE2
+        return static_cast<uint32_t>(_mm_movemask_epi8(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(control))));
+#else
+        uint32_t mask{0};
+        for (size_t i{0}; i < GROUP_SIZE; ++i)
+            mask |= uint32_t{control[i] < 0} << i;
+        return mask;
+#endif
+    }
+
+    // Groups are visited in triangular order, which reaches every group
+    // of a power of two table. Calls visit(first slot of the group) until
+    // it returns true.
+    template <class Visitor>
+    void _probe(uint64_t hash, Visitor&& visit) const noexcept
+    {
+        const size_t group_mask{m_slots.size() / GROUP_SIZE - 1};
+        size_t group{static_cast<size_t>(hash >> 7) & group_mask};
+        for (size_t step{1}; !visit(group * GROUP_SIZE); ++step)
+            group = (group + step) & group_mask;
+    }
+
+    size_t _find(uint32_t value) const noexcept
+    {
+        if (m_slots.empty())
+            return NPOS;
+
+        const uint64_t hash{ip_detail::mix(value)};
+        const auto tag{static_cast<int8_t>(hash & 0x7F)};
+        size_t found{NPOS};
+        _probe(hash,
+               [&](size_t first)
+               {
+                   const int8_t* control{m_control.data() + first};
+                   for (uint32_t hits{_match(control, tag)}; hits != 0;
+                        hits &= hits - 1)
+                   {
+                       const size_t slot{first + std::countr_zero(hits)};
+                       if (m_slots[slot] == value)
+                       {
+                           found = slot;
+                           return true;
+                       }
+                   }
+                   // an EMPTY slot ends every probe sequence
+                   return _match(control, EMPTY) != 0;
+               });
+        return found;
+    }
+
+    // value must not be present and a free slot must exist
+    void _emplace(uint32_t value) noexcept
+    {
+        const uint64_t hash{ip_detail::mix(value)};
+        _probe(hash,
+               [&](size_t first)
+               {
+                   const uint32_t free{_match_free(m_control.data() + first)};
+                   if (free == 0)
+                       return false;
+
+                   const size_t slot{first + std::countr_zero(free)};
+                   m_deleted -= m_control[slot] == DELETED;
+                   m_control[slot] = static_cast<int8_t>(hash & 0x7F);
+                   m_slots[slot] = value;
+                   return true;
+               });
+    }
+
+    // Rebuilds into capacity slots, dropping tombstones and dense /8s
+    void _rehash(size_t capacity)
+    {
+        std::vector<int8_t> control(capacity, EMPTY);
+        std::vector<uint32_t> slots(capacity);
+        control.swap(m_control);
+        slots.swap(m_slots);
+        m_deleted = 0;
+
+        for (size_t slot{0}; slot < slots.size(); ++slot)
+            if (control[slot] >= 0 && m_dense[slots[slot] >> 24] == nullptr)
+                _emplace(slots[slot]);
+    }
+
+    void _make_dense(uint32_t top)
+    {
+        auto& bits{m_dense[top]};
+        bits = std::make_unique<uint64_t[]>(DENSE_WORDS);
+        for (size_t slot{0}; slot < m_slots.size(); ++slot)
+        {
+            const uint32_t value{m_slots[slot]};
+            if (m_control[slot] >= 0 && value >> 24 == top)
+                bits[(value & 0xFFFFFF) / 64] |= uint64_t{1} << (value % 64);
+        }
+
+        m_dense_size += m_counts[top];
+        m_counts[top] = 0;
+        _rehash(m_slots.size());
+    }
+};
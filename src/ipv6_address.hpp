@@ -0,0 +1,341 @@
+#pragma once
+
+#include "ip_address.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <charconv>
+#include <compare>
+#include <cstdint>
+#include <format>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace ip_detail
+{
+// "ffff:ffff:ffff:ffff:ffff:ffff:255.255.255.255"
+inline constexpr size_t MAX_IPV6_LENGTH = 45;
+
+// RFC 4291 text form: up to eight 1-4 digit hex groups, one "::" for a run
+// of zero groups and an optional dotted IPv4 tail, which goes through the
+// same parser as plain IPv4 addresses. groups[0] is the first group.
+constexpr ip_error parse_ipv6(std::string_view str,
+                              std::array<uint16_t, 8>& out) noexcept
+{
+    if (str.empty())
+        return ip_error::empty;
+    if (str.size() > MAX_IPV6_LENGTH)
+        return ip_error::too_long;
+
+    std::array<uint16_t, 8> groups{};
+    size_t count{0}, pos{0};
+    int compress_at{-1};
+
+    if (str[0] == ':')
+    {
+        if (str.size() < 2 || str[1] != ':')
+            return ip_error::misplaced_compression;
+        compress_at = 0;
+        pos = 2;
+    }
+
+    while (pos < str.size())
+    {
+        if (count == 8)
+            return ip_error::wrong_group_count;
+
+        const size_t start{pos};
+        uint32_t value{0};
+        for (int digit{0};
+             pos < str.size() && (digit = hex_value(str[pos])) >= 0; ++pos)
+        {
+            if (pos - start == 4)
+                return ip_error::group_out_of_range;
+            value = value << 4 | static_cast<uint32_t>(digit);
+        }
+
+        if (pos < str.size() && str[pos] == '.')
+        {
+            if (count > 6)
+                return ip_error::wrong_group_count;
+
+            uint32_t tail{0};
+            const ip_error error{parse_ipv4_scalar(str.substr(start), tail)};
+            if (error != ip_error::ok)
+                return error;
+
+            groups[count++] = static_cast<uint16_t>(tail >> 16);
+            groups[count++] = static_cast<uint16_t>(tail);
+            break;
+        }
+        if (pos == start)
+            return pos == str.size() ? ip_error::misplaced_compression
+                                     : ip_error::invalid_character;
+
+        groups[count++] = static_cast<uint16_t>(value);
+        if (pos == str.size())
+            break;
+        if (str[pos] != ':')
+            return ip_error::invalid_character;
+
+        if (++pos == str.size())
+            return ip_error::misplaced_compression;
+        if (str[pos] == ':')
+        {
+            if (compress_at >= 0)
+                return ip_error::misplaced_compression;
+            compress_at = static_cast<int>(count);
+            ++pos;
+        }
+    }
+
+    if (compress_at < 0)
+    {
+        if (count != 8)
+            return ip_error::wrong_group_count;
+    }
+    else
+    {
+        // "::" stands for at least one zero group
+        if (count > 7)
+            return ip_error::wrong_group_count;
+
+        const auto gap{static_cast<size_t>(compress_at)};
+        std::copy_backward(groups.begin() + gap, groups.begin() + count,
+                           groups.end());
+        std::fill_n(groups.begin() + gap, 8 - count, uint16_t{0});
+    }
+
+    out = groups;
+    return ip_error::ok;
+}
+} // namespace ip_detail
+
+class IPv6address final
+{
+public:
+    // Network order. Public only because that makes IPv6address a
+    // structural type, usable as a template argument; use bytes() instead.
+    std::array<uint8_t, 16> m_bytes{};
+
+    // without zone id
+    static constexpr size_t MAX_STRING_LENGTH = ip_detail::MAX_IPV6_LENGTH;
+
+    constexpr IPv6address() noexcept = default;
+
+    // groups in text order
+    constexpr explicit IPv6address(
+        const std::array<uint16_t, 8>& groups) noexcept
+    {
+        for (size_t i{0}; i < 8; ++i)
+        {
+            m_bytes[2 * i] = static_cast<uint8_t>(groups[i] >> 8);
+            m_bytes[2 * i + 1] = static_cast<uint8_t>(groups[i]);
+        }
+    }
+
+    constexpr explicit IPv6address(
+        const std::array<uint8_t, 16>& bytes) noexcept
+        : m_bytes{bytes}
+    {
+    }
+
+    // ::ffff:a.b.c.d
+    static constexpr IPv6address mapped(IPaddress address) noexcept
+    {
+        const uint32_t value{address.to_uint32()};
+        return IPv6address{std::array<uint16_t, 8>{
+            0, 0, 0, 0, 0, 0xFFFF, static_cast<uint16_t>(value >> 16),
+            static_cast<uint16_t>(value)}};
+    }
+
+    constexpr bool is_v4_mapped() const noexcept
+    {
+        return std::all_of(m_bytes.begin(), m_bytes.begin() + 10,
+                           [](uint8_t byte) { return byte == 0; }) &&
+               m_bytes[10] == 0xFF && m_bytes[11] == 0xFF;
+    }
+
+    // last 32 bits
+    constexpr IPaddress to_v4() const noexcept
+    {
+        return IPaddress{m_bytes[12], m_bytes[13], m_bytes[14], m_bytes[15]};
+    }
+
+    constexpr const std::array<uint8_t, 16>& bytes() const noexcept
+    {
+        return m_bytes;
+    }
+
+    // index 0 is the last group of the text form, only 3 low bits are used
+    constexpr uint16_t get_hextet(size_t index) const noexcept
+    {
+        const size_t byte{(7 - (index & 7)) * 2};
+        return static_cast<uint16_t>(m_bytes[byte] << 8 | m_bytes[byte + 1]);
+    }
+
+    constexpr uint64_t high() const noexcept { return _half(0); }
+    constexpr uint64_t low() const noexcept { return _half(8); }
+
+    constexpr bool operator==(const IPv6address&) const noexcept = default;
+    constexpr std::strong_ordering
+    operator<=>(const IPv6address&) const noexcept = default;
+
+    // Writes RFC 5952 canonical text: lower case, no leading zeros, the
+    // longest run of two or more zero groups (the first one on a tie)
+    // becomes "::", IPv4-mapped addresses end in dotted form.
+    // Needs MAX_STRING_LENGTH bytes, returns the past-the-end pointer.
+    constexpr char* to_chars(char* first) const noexcept
+    {
+        constexpr std::string_view hex_digits{"0123456789abcdef"};
+
+        std::array<uint16_t, 8> groups{};
+        for (size_t i{0}; i < 8; ++i)
+            groups[i] = get_hextet(7 - i);
+
+        size_t best_start{8}, best_length{1};
+        for (size_t i{0}; i < 8;)
+        {
+            size_t length{0};
+            while (i + length < 8 && groups[i + length] == 0)
+                ++length;
+            if (length > best_length)
+            {
+                best_start = i;
+                best_length = length;
+            }
+            i += length + 1;
+        }
+
+        const size_t group_count{is_v4_mapped() ? size_t{6} : size_t{8}};
+        for (size_t i{0}; i < group_count; ++i)
+        {
+            if (i == best_start)
+            {
+                *first++ = ':';
+                *first++ = ':';
+                i += best_length - 1;
+                continue;
+            }
+            if (i != 0 && i != best_start + best_length)
+                *first++ = ':';
+
+            const uint16_t group{groups[i]};
+            for (int shift{std::max(12 - std::countl_zero(group) / 4 * 4, 0)};
+                 shift >= 0; shift -= 4)
+                *first++ = hex_digits[group >> shift & 0xF];
+        }
+
+        if (group_count == 6)
+        {
+            if (best_start + best_length != 6)
+                *first++ = ':';
+            for (size_t i{12}; i < 16; ++i)
+            {
+                if (i != 12)
+                    *first++ = '.';
+                const auto& digits{ip_detail::OCTET_DIGITS[m_bytes[i]]};
+                first = std::copy_n(digits.data(), digits[3], first);
+            }
+        }
+        return first;
+    }
+
+    inline std::string to_string() const
+    {
+        char buffer[MAX_STRING_LENGTH];
+        return {buffer, to_chars(buffer)};
+    }
+
+    inline operator std::string() const { return to_string(); }
+
+    // std::to_chars style for buffers of any size
+    constexpr std::to_chars_result to_chars(char* first,
+                                            char* last) const noexcept
+    {
+        char buffer[MAX_STRING_LENGTH];
+        char* const end{to_chars(buffer)};
+        const auto length{end - buffer};
+        if (last - first < length)
+            return {last, std::errc::value_too_large};
+        return {std::copy(buffer, end, first), std::errc{}};
+    }
+
+    // Accepts an optional "%zone" suffix; its text is returned through
+    // zone (a view into addr) when requested.
+    static constexpr ip_error
+    try_parse(std::string_view addr, IPv6address& result,
+              std::string_view* zone = nullptr) noexcept
+    {
+        const size_t percent{addr.find('%')};
+        if (percent != std::string_view::npos)
+        {
+            if (percent + 1 == addr.size())
+                return ip_error::invalid_zone;
+            if (zone != nullptr)
+                *zone = addr.substr(percent + 1);
+            addr = addr.substr(0, percent);
+        }
+        else if (zone != nullptr)
+            *zone = {};
+
+        std::array<uint16_t, 8> groups{};
+        const ip_error error{ip_detail::parse_ipv6(addr, groups)};
+        if (error == ip_error::ok)
+            result = IPv6address{groups};
+        return error;
+    }
+
+    // Compile time only, a malformed address fails the build
+    static consteval IPv6address parse(std::string_view addr)
+    {
+        IPv6address result;
+        if (try_parse(addr, result) != ip_error::ok)
+            throw std::invalid_argument{"IPv6address::parse: bad ip address"};
+        return result;
+    }
+
+private:
+    constexpr uint64_t _half(size_t offset) const noexcept
+    {
+        uint64_t result{0};
+        for (size_t i{0}; i < 8; ++i)
+            result = result << 8 | m_bytes[offset + i];
+        return result;
+    }
+};
+
+template <>
+struct std::formatter<IPv6address>
+{
+    template <class ParseContext>
+    constexpr auto parse(ParseContext& ctx)
+    {
+        if (ctx.begin() != ctx.end() && *ctx.begin() != '}')
+            throw std::format_error{"IPv6address takes no format spec"};
+        return ctx.begin();
+    }
+
+    template <class FormatContext>
+    auto format(const IPv6address& addr, FormatContext& ctx) const
+    {
+        char buffer[IPv6address::MAX_STRING_LENGTH];
+        return std::copy(buffer, addr.to_chars(buffer), ctx.out());
+    }
+};
+
+namespace ip_literals
+{
+// "2001:db8::1"_ip6
+consteval IPv6address operator""_ip6(const char* addr, size_t length)
+{
+    return IPv6address::parse({addr, length});
+}
+} // namespace ip_literals
+
+static_assert(sizeof(IPv6address) == 16);
+static_assert(std::is_trivially_copyable_v<IPv6address>);
+static_assert(IPv6address::parse("::ffff:10.0.0.1").to_v4() ==
+              IPaddress::parse("10.0.0.1"));
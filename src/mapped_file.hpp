@@ -0,0 +1,79 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <format>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Read-only memory mapping of a whole file
+class mapped_file final
+{
+public:
+    explicit mapped_file(const std::string& path)
+    {
+        const int fd{::open(path.c_str(), O_RDONLY)};
+        if (fd < 0)
+            throw std::runtime_error(
+                std::format("[FATAL] Can't open file \"{}\"!", path));
+
+        struct stat info{};
+        if (::fstat(fd, &info) < 0)
+        {
+            ::close(fd);
+            throw std::runtime_error(
+                std::format("[FATAL] Can't stat file \"{}\"!", path));
+        }
+
+        m_size = static_cast<size_t>(info.st_size);
+        if (m_size > 0)
+        {
+            void* data{::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0)};
+            if (data == MAP_FAILED)
+            {
+                ::close(fd);
+                throw std::runtime_error(
+                    std::format("[FATAL] Can't map file \"{}\"!", path));
+            }
+            ::madvise(data, m_size, MADV_SEQUENTIAL);
+            m_data = static_cast<const char*>(data);
+        }
+        // the mapping stays valid after the descriptor is closed
+        ::close(fd);
+    }
+
+    ~mapped_file() noexcept
+    {
+        if (m_data != nullptr)
+            ::munmap(const_cast<char*>(m_data), m_size);
+    }
+
+    // Drops the pages wholly before offset from memory; reading them again
+    // faults them back in from the file
+    void release(size_t offset) const noexcept
+    {
+        const auto page{static_cast<size_t>(::sysconf(_SC_PAGESIZE))};
+        const size_t length{std::min(offset, m_size) / page * page};
+        if (length > 0)
+            ::madvise(const_cast<char*>(m_data), length, MADV_DONTNEED);
+    }
+
+    std::string_view view() const noexcept { return {m_data, m_size}; }
+    const char* data() const noexcept { return m_data; }
+    size_t size() const noexcept { return m_size; }
+
+private:
+    mapped_file(const mapped_file&) = delete;
+    mapped_file(mapped_file&&) noexcept = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+    mapped_file& operator=(mapped_file&&) noexcept = delete;
+
+    const char* m_data{nullptr};
+    size_t m_size{0};
+};
@@ -1,3 +1,4 @@
+#include "probe.hpp"
 #include <algorithm>
 #include <cstdint>
 #include <exception>
@@ -61,6 +62,7 @@ const std::unordered_map<unsigned char, const std::string>
 
 std::string morze_coder::encode(const std::string& str)
 {
+    PROBE_SCOPE("morze_coder::encode");
     std::string result;
     result.reserve(str.size() * AVERAGE_MORZE_SYMBOL_LENGHT);
 
@@ -73,6 +75,8 @@ std::string morze_coder::encode(const std::string& str)
 
 int main(int argc, char* argv[])
 {
+    probe::install();
+
     if (argc != 2)
     {
         std::cout << "Usage: morze_coder <message>\n";
@@ -8,20 +8,52 @@
  * @todo MORE STD!!!
  */
 
+#include "font_atlas.hpp"
+#include "timer.hpp"
 #include <algorithm>
 #include <array>
 #include <cassert>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <csignal>
 #include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
 #include <format>
+#include <fstream>
 #include <iostream>
 #include <iterator>
+#include <limits>
 #include <ranges>
+#include <span>
+#include <sstream>
+#include <stdexcept>
+#include <string>
 #include <string_view>
-#include <unordered_map>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
 
 namespace rng = std::ranges;
 namespace views = std::views;
 
+// One write() call unless fd takes data in parts, false on an error
+inline bool write_all(int fd, std::string_view data) noexcept
+{
+    while (!data.empty())
+    {
+        const ssize_t written{::write(fd, data.data(), data.size())};
+        if (written < 0 && errno != EINTR)
+            return false;
+        if (written > 0)
+            data.remove_prefix(static_cast<size_t>(written));
+    }
+    return true;
+}
+
 class Renderer final
 {
 private:
@@ -29,17 +61,19 @@ private:
     {
         static constexpr size_t VERTICAL_SPACE = 1;
         static constexpr size_t HORIZONTAL_SPACE = 1;
-        static constexpr size_t DIGIT_NUMBER = 12;
-        static constexpr auto DIGIT_FORMAT = "{:0>{}}";
+        // extra columns between two fields of a grid row
+        static constexpr size_t FIELD_SPACE = 2;
+        // digits of a single drawn number, padded with zeros
+        static constexpr size_t DEFAULT_WIDTH = 12;
         static constexpr size_t DIGIT_HEIGHT = 9, DIGIT_WIDTH = 7;
-        static constexpr size_t BUFFER_HEIGHT = DIGIT_HEIGHT + 2;
-        static constexpr size_t BUFFER_WIDTH = DIGIT_WIDTH * DIGIT_NUMBER +
-                                               HORIZONTAL_SPACE * DIGIT_NUMBER +
-                                               HORIZONTAL_SPACE;
+        // of the built-in digits, a glyph with the space on its right
+        static constexpr size_t ROW_HEIGHT = DIGIT_HEIGHT + VERTICAL_SPACE;
+        static constexpr size_t CELL_WIDTH = DIGIT_WIDTH + HORIZONTAL_SPACE;
+        static constexpr char INK = '#', BLANK = ' ';
 
         using digit_t = std::array<std::array<char, DIGIT_WIDTH>, DIGIT_HEIGHT>;
-        using digit_buffer_t =
-            std::array<std::array<char, BUFFER_WIDTH>, BUFFER_HEIGHT>;
+        // one pixel row of a glyph expanded to characters
+        using byte_cells_t = std::array<std::array<char, 8>, 256>;
     };
 
     // clang-format off
@@ -168,94 +202,818 @@ static constexpr Config::digit_t nine{
 };
 
     // clang-format on
+
+    // char_digits converted to a font atlas at compile time
+    static constexpr auto DIGIT_FONT_FILE{
+        []
+        {
+            constexpr std::array<Config::digit_t, 10> art{
+                char_digits::zero, char_digits::one,   char_digits::two,
+                char_digits::three, char_digits::four, char_digits::five,
+                char_digits::six,  char_digits::seven, char_digits::eight,
+                char_digits::nine};
+            constexpr std::array<char, 10> chars{'0', '1', '2', '3', '4',
+                                                 '5', '6', '7', '8', '9'};
+
+            std::array<uint8_t, font_atlas::file_size(Config::DIGIT_WIDTH,
+                                                      Config::DIGIT_HEIGHT,
+                                                      chars.size())>
+                file{};
+            write_font_atlas(chars, Config::DIGIT_WIDTH, Config::DIGIT_HEIGHT,
+                             [&art](size_t glyph, size_t y, size_t x)
+                             { return art[glyph][y][x] == Config::INK; },
+                             file.begin());
+            return file;
+        }()};
+    static constexpr font_atlas DIGIT_FONT{DIGIT_FONT_FILE};
+
+    // Every byte of a glyph row already expanded to characters, so
+    // blitting 8 pixels is one fixed size copy
+    static constexpr Config::byte_cells_t BYTE_CELLS{
+        []
+        {
+            Config::byte_cells_t cells{};
+            for (size_t byte{0}; byte < cells.size(); ++byte)
+                for (size_t x{0}; x < 8; ++x)
+                    cells[byte][x] =
+                        byte & (0x80 >> x) ? Config::INK : Config::BLANK;
+            return cells;
+        }()};
+
+    static_assert(DIGIT_FONT.glyph('8')[3] == 0b0011100 << 1);
+    static_assert(DIGIT_FONT.glyph('x') == nullptr);
+
+    // Pixel row i of count glyphs of font, each followed by the
+    // horizontal space. Returns the end of the output.
+    static constexpr char* _blit(const font_atlas& font,
+                                 const uint8_t* const* glyphs, size_t count,
+                                 size_t i, char* out) noexcept
+    {
+        const size_t cell_width{font.width() + Config::HORIZONTAL_SPACE};
+        const size_t row_bytes{font.row_bytes()};
+        // Unused low bits are 0, so they draw the space after the glyph.
+        // The usual case is a row that fits into its cell in whole bytes.
+        const size_t whole{std::min(row_bytes, cell_width / 8)};
+        if (row_bytes == 1 && cell_width == 8)
+        {
+            // the built-in digits: one byte and one copy per cell
+            for (size_t j{0}; j < count; ++j, out += 8)
+                std::copy_n(BYTE_CELLS[glyphs[j][i]].data(), 8, out);
+            return out;
+        }
+        for (size_t j{0}; j < count; ++j, out += cell_width)
+        {
+            const uint8_t* row{glyphs[j] + i * row_bytes};
+            for (size_t byte{0}; byte < whole; ++byte)
+                std::copy_n(BYTE_CELLS[row[byte]].data(), 8, out + byte * 8);
+            if (whole == row_bytes)
+                std::fill(out + whole * 8, out + cell_width, Config::BLANK);
+            else
+                std::copy_n(BYTE_CELLS[row[whole]].data(),
+                            cell_width - whole * 8, out + whole * 8);
+        }
+        return out;
+    }
+
+    static constexpr size_t _digit_count(size_t number) noexcept
+    {
+        size_t count{1};
+        for (; number >= 10; number /= 10)
+            ++count;
+        return count;
+    }
+
+    static constexpr size_t _static_line(size_t number, size_t width) noexcept
+    {
+        return Config::HORIZONTAL_SPACE +
+               std::max(_digit_count(number), width) * Config::CELL_WIDTH + 1;
+    }
+
+    template <size_t Number, size_t Width>
+    static consteval auto _render_static()
+    {
+        constexpr size_t cells{std::max(_digit_count(Number), Width)};
+        constexpr size_t line{_static_line(Number, Width)};
+        constexpr size_t height{Config::VERTICAL_SPACE + Config::ROW_HEIGHT};
+
+        std::array<const uint8_t*, cells> glyphs{};
+        glyphs.fill(DIGIT_FONT.glyph('0'));
+        size_t rest{Number};
+        for (size_t j{cells}; j-- > cells - _digit_count(Number); rest /= 10)
+            glyphs[j] = DIGIT_FONT.glyph(static_cast<char>('0' + rest % 10));
+
+        std::array<char, line * height> frame{};
+        frame.fill(Config::BLANK);
+        for (size_t y{0}; y < height; ++y)
+            frame[y * line + line - 1] = '\n';
+        for (size_t i{0}; i < Config::DIGIT_HEIGHT; ++i)
+            _blit(DIGIT_FONT, glyphs.data(), cells, i,
+                  frame.data() + (Config::VERTICAL_SPACE + i) * line +
+                      Config::HORIZONTAL_SPACE);
+        return frame;
+    }
+
 public:
-    Renderer() { clear_buffer(); }
+    enum class align
+    {
+        left,
+        right,
+        center
+    };
+
+    // One value of a grid, characters the font lacks are drawn blank
+    struct field
+    {
+        std::string_view text;
+        // in characters, longer text is never cut
+        size_t width{0};
+        align alignment{align::right};
+        // pads the field up to the width of its grid column
+        char fill{Config::BLANK};
+    };
+
+    Renderer() = default;
     ~Renderer() = default;
 
-    void draw(std::size_t num)
+    // Glyphs of the built-in digits in the font_atlas format
+    static constexpr std::span<const uint8_t> builtin_font() noexcept
+    {
+        return DIGIT_FONT_FILE;
+    }
+
+    // Draws later frames with font, which has to outlive its use;
+    // draw<Number>() always uses the built-in digits
+    void set_font(const font_atlas& font) noexcept { m_font = font; }
+
+    // Zero padded to DEFAULT_WIDTH digits, longer numbers get wider
+    void draw(size_t num)
     {
-        _draw_impl(
-            std::format(Config::DIGIT_FORMAT, num, Config::DIGIT_NUMBER));
+        char digits[std::numeric_limits<size_t>::digits10 + 1];
+        const char* end{std::to_chars(std::begin(digits), std::end(digits), num)
+                            .ptr};
+        draw(std::string_view{digits, end});
     }
 
     void draw(std::string_view num)
     {
         assert(rng::all_of(num, isdigit));
-        _draw_impl(
-            std::format(Config::DIGIT_FORMAT, num, Config::DIGIT_NUMBER));
+        const field single{num, Config::DEFAULT_WIDTH, align::right, '0'};
+        draw(std::span{&single, 1});
     }
 
+    // Lays fields out in rows of columns fields. Every grid column is as
+    // wide as its widest field; the frame is replaced as a whole.
+    void draw(std::span<const field> fields, size_t columns = 1)
+    {
+        assert(columns > 0);
+        columns = std::min(columns, std::max(fields.size(), size_t{1}));
+        const size_t rows{(fields.size() + columns - 1) / columns};
+
+        m_column_widths.assign(columns, 0);
+        for (size_t i{0}; i < fields.size(); ++i)
+        {
+            size_t& width{m_column_widths[i % columns]};
+            width = std::max({width, fields[i].width, fields[i].text.size()});
+        }
+
+        const size_t cell_width{m_font.width() + Config::HORIZONTAL_SPACE};
+        const size_t row_height{m_font.height() + Config::VERTICAL_SPACE};
+        m_blank.assign(m_font.height() * m_font.row_bytes(), 0);
+        size_t width{Config::HORIZONTAL_SPACE + (columns - 1) *
+                                                    Config::FIELD_SPACE};
+        for (const size_t cells : m_column_widths)
+            width += cells * cell_width;
+        _resize(width, Config::VERTICAL_SPACE + rows * row_height);
+
+        for (size_t row{0}; row < rows; ++row)
+            _write_row(fields.subspan(row * columns,
+                                      std::min(columns,
+                                               fields.size() - row * columns)),
+                       Config::VERTICAL_SPACE + row * row_height);
+    }
+
+    // Shows static_frame<Number> with a single copy, the same frame as
+    // draw(Number)
+    template <size_t Number>
+    void draw()
+    {
+        constexpr auto& frame{static_frame<Number>};
+        constexpr size_t line{_static_line(Number, Config::DEFAULT_WIDTH)};
+        _reserve(line, frame.size() / line);
+        std::copy(frame.begin(), frame.end(), m_frame.begin());
+    }
+
+    // Numbers right aligned in fields of at least width digits
+    void draw(std::span<const size_t> numbers, size_t columns,
+              size_t width = 0, align alignment = align::right)
+    {
+        constexpr size_t max_digits{std::numeric_limits<size_t>::digits10 +
+                                    1};
+        m_digits.resize(numbers.size() * max_digits);
+        m_fields.clear();
+        for (size_t i{0}; i < numbers.size(); ++i)
+        {
+            char* first{m_digits.data() + i * max_digits};
+            const char* last{
+                std::to_chars(first, first + max_digits, numbers[i]).ptr};
+            m_fields.push_back(
+                {std::string_view{first, last}, width, alignment});
+        }
+        draw(m_fields, columns);
+    }
+
+    // Blanks the frame, keeping its size
     void clear_buffer() noexcept
     {
-        rng::for_each(m_buffer, [](auto& row) { row.fill(' '); });
+        for (size_t y{0}; y < m_height; ++y)
+            std::fill_n(m_frame.data() + y * m_line, m_line - 1,
+                        Config::BLANK);
     }
 
-    // draw buffer in console
-    void display(std::ostream& stream = std::cout) const noexcept
+    // The whole frame, lines end in '\n'
+    std::string_view frame() const noexcept
     {
-        rng::for_each(m_buffer,
-                      [&stream](const auto& row)
-                      {
-                          rng::copy(row, std::ostream_iterator<char>(stream));
-                          stream << '\n';
-                      });
+        return {m_frame.data(), m_line * m_height};
     }
 
-private:
-    Config::digit_buffer_t m_buffer;
+    // characters per line, the '\n' included
+    size_t line_length() const noexcept { return m_line; }
+
+    // Frame of Number zero padded to Width digits, rendered at compile
+    // time from the built-in digits with the same blit as draw()
+    template <size_t Number, size_t Width = Config::DEFAULT_WIDTH>
+    static constexpr auto static_frame{_render_static<Number, Width>()};
+
+    void display(std::ostream& stream) const
+    {
+        stream.write(m_frame.data(),
+                     static_cast<std::streamsize>(frame().size()));
+    }
+
+    // The frame in one write() call, flush streams writing to fd first.
+    // Returns false on an error.
+    bool display(int fd = STDOUT_FILENO) const noexcept
+    {
+        return write_all(fd, frame());
+    }
 
-    // fill map with defined digits
-    inline static const std::unordered_map<char, Config::digit_t> numbers{
-        {'0', char_digits::zero},  {'1', char_digits::one},
-        {'2', char_digits::two},   {'3', char_digits::three},
-        {'4', char_digits::four},  {'5', char_digits::five},
-        {'6', char_digits::six},   {'7', char_digits::seven},
-        {'8', char_digits::eight}, {'9', char_digits::nine}};
+private:
+    // lines of m_line characters including the '\n', capacity only grows
+    std::vector<char> m_frame;
+    size_t m_line{0};
+    size_t m_height{0};
+    font_atlas m_font{DIGIT_FONT};
+    // scratch space of draw(), kept to avoid allocating every frame
+    std::vector<size_t> m_column_widths;
+    std::vector<const uint8_t*> m_cells;
+    // stands in for characters the font lacks
+    std::vector<uint8_t> m_blank;
+    std::vector<char> m_digits;
+    std::vector<field> m_fields;
 
-    void _draw_impl(std::string_view num) noexcept { _write_buffer(num); }
+    // Sizes the frame for lines of line characters, contents unspecified
+    void _reserve(size_t line, size_t height)
+    {
+        m_line = line;
+        m_height = height;
+        const size_t size{m_line * m_height};
+        if (size > m_frame.capacity())
+            m_frame.reserve(std::max(size, 2 * m_frame.capacity()));
+        m_frame.resize(size);
+    }
 
-    void _write_buffer(std::string_view num)
+    // Sizes the frame for width characters and height lines and blanks it
+    void _resize(size_t width, size_t height)
     {
-        rng::for_each(views::iota(0ul, Config::DIGIT_NUMBER),
-                      [&](auto i)
-                      {
-                          _write_digit_to_buffer(
-                              numbers.at(num[i]),
-                              (Config::DIGIT_WIDTH + Config::HORIZONTAL_SPACE) *
-                                      i +
-                                  Config::HORIZONTAL_SPACE,
-                              Config::VERTICAL_SPACE);
-                      });
+        _reserve(width + 1, height);
+        clear_buffer();
+        for (size_t y{0}; y < m_height; ++y)
+            m_frame[y * m_line + m_line - 1] = '\n';
     }
 
-    void _write_digit_to_buffer(Config::digit_t const& digit, size_t x_offset,
-                                size_t y_offset) noexcept
+    // One grid row with its first glyph line at top
+    void _write_row(std::span<const field> fields, size_t top)
     {
-        for (auto i : views::iota(0ul, Config::DIGIT_HEIGHT))
-            for (auto j : views::iota(0ul, Config::DIGIT_WIDTH))
-                m_buffer[y_offset + i][x_offset + j] = digit[i][j];
+        // glyph of every cell of the row, padding included
+        const auto glyph{[this](char ch)
+                         {
+                             const uint8_t* glyph{m_font.glyph(ch)};
+                             return glyph != nullptr ? glyph : m_blank.data();
+                         }};
+        m_cells.clear();
+        for (size_t i{0}; i < fields.size(); ++i)
+        {
+            const field& item{fields[i]};
+            const size_t pad{m_column_widths[i] - item.text.size()};
+            const size_t before{item.alignment == align::left    ? 0
+                                : item.alignment == align::right ? pad
+                                                                 : pad / 2};
+            const uint8_t* fill{glyph(item.fill)};
+            m_cells.insert(m_cells.end(), before, fill);
+            for (const char ch : item.text)
+                m_cells.push_back(glyph(ch));
+            m_cells.insert(m_cells.end(), pad - before, fill);
+        }
+
+        // row by row, so the stores into the frame stay sequential
+        for (size_t i{0}; i < m_font.height(); ++i)
+        {
+            char* out{m_frame.data() + (top + i) * m_line +
+                      Config::HORIZONTAL_SPACE};
+            const uint8_t* const* cell{m_cells.data()};
+            for (size_t column{0}; column < fields.size(); ++column)
+            {
+                if (column != 0)
+                    out += Config::FIELD_SPACE;
+                out = _blit(m_font, cell, m_column_widths[column], i, out);
+                cell += m_column_widths[column];
+            }
+        }
     }
 };
 
+static_assert(Renderer::static_frame<0>.size() == 98 * 11);
+static_assert(std::string_view{Renderer::static_frame<7, 1>.data(), 20} ==
+              "         \n ####### \n");
+
 std::ostream& operator<<(std::ostream& stream, const Renderer& render)
 {
     render.display(stream);
     return stream;
 }
 
+// Live terminal view of a Renderer: the first frame is drawn in full,
+// later ones only rewrite the characters that changed since the last
+// frame shown. Changed characters at most MAX_GAP apart are sent as one
+// run together with the unchanged ones between them, since that is no
+// more than another cursor move would cost. Frames coming faster than
+// max_fps are dropped.
+class LiveDisplay final
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+    explicit LiveDisplay(double max_fps = 30, int fd = STDOUT_FILENO)
+        : m_fd{fd},
+          m_interval{std::chrono::duration_cast<clock::duration>(
+              std::chrono::duration<double>{1 / max_fps})}
+    {
+        assert(max_fps > 0);
+    }
+
+    // Leaves the cursor visible below the last frame
+    ~LiveDisplay()
+    {
+        m_out = std::format("\x1b[{};1H\x1b[?25h", m_height + 1);
+        write_all(m_fd, m_out);
+    }
+
+    // Returns false when the frame was dropped by the rate limit or the
+    // write failed; force skips the rate limit, e.g. for the last frame
+    bool present(const Renderer& render, bool force = false)
+    {
+        const clock::time_point now{clock::now()};
+        if (!force && m_frames != 0 && now - m_last < m_interval)
+            return false;
+
+        const std::string_view frame{render.frame()};
+        if (frame.size() != m_previous.size() ||
+            render.line_length() != m_line)
+            _full(frame, render.line_length());
+        else
+            _diff(frame);
+
+        m_previous.assign(frame);
+        m_last = now;
+        ++m_frames;
+        m_bytes += m_out.size();
+        return write_all(m_fd, m_out);
+    }
+
+    size_t frames() const noexcept { return m_frames; }
+    // written to the terminal so far, escapes included
+    size_t bytes() const noexcept { return m_bytes; }
+
+private:
+    LiveDisplay(const LiveDisplay&) = delete;
+    LiveDisplay(LiveDisplay&&) noexcept = delete;
+    LiveDisplay& operator=(const LiveDisplay&) = delete;
+    LiveDisplay& operator=(LiveDisplay&&) noexcept = delete;
+
+    // a forward cursor move takes at least four bytes
+    static constexpr size_t MAX_GAP = 4;
+
+    int m_fd;
+    clock::duration m_interval;
+    clock::time_point m_last{};
+    // the frame on screen, m_line characters per line with the '\n'
+    std::string m_previous;
+    size_t m_line{0};
+    size_t m_height{0};
+    // where the terminal cursor is, 0 based
+    size_t m_row{0}, m_column{0};
+    // escapes and text of one update, reused
+    std::string m_out;
+    size_t m_frames{0};
+    size_t m_bytes{0};
+
+    // hides the cursor, clears the screen and draws from the top left
+    void _full(std::string_view frame, size_t line)
+    {
+        m_line = line;
+        m_height = line == 0 ? 0 : frame.size() / line;
+        m_out.assign("\x1b[?25l\x1b[H\x1b[2J");
+        m_out.append(frame);
+        m_row = m_height;
+        m_column = 0;
+    }
+
+    // the shortest of a forward move in the line or an absolute move
+    void _move_to(size_t row, size_t column)
+    {
+        if (row == m_row && column == m_column)
+            return;
+        if (row == m_row && column > m_column)
+            std::format_to(std::back_inserter(m_out), "\x1b[{}C",
+                           column - m_column);
+        else
+            std::format_to(std::back_inserter(m_out), "\x1b[{};{}H", row + 1,
+                           column + 1);
+        m_row = row;
+        m_column = column;
+    }
+
+    void _diff(std::string_view frame)
+    {
+        m_out.clear();
+        const size_t width{m_line - 1};
+        for (size_t y{0}; y < m_height; ++y)
+        {
+            const char* now{frame.data() + y * m_line};
+            const char* old{m_previous.data() + y * m_line};
+            if (std::equal(now, now + width, old))
+                continue;
+
+            for (size_t x{0}; x < width;)
+            {
+                const size_t first{static_cast<size_t>(
+                    std::mismatch(now + x, now + width, old + x).first - now)};
+                if (first == width)
+                    break;
+
+                // extend the run while the next change is close enough
+                size_t end{first + 1};
+                for (size_t i{end}; i < width && i - end < MAX_GAP; ++i)
+                    if (now[i] != old[i])
+                        end = i + 1;
+
+                _move_to(y, first);
+                m_out.append(now + first, end - first);
+                m_column = x = end;
+            }
+        }
+    }
+};
+
+// Time of one draw() call, the numbers change every frame. Returns
+// whether compile time frames match the ones drawn at run time.
+inline bool render_benchmark()
+{
+    Renderer render;
+    Timer measure;
+    size_t number{0};
+    std::vector<benchmark_result> results;
+    results.push_back(measure.benchmark("draw 12 digits",
+                                        [&]
+                                        {
+                                            render.draw(number);
+                                            number += 1'234'567;
+                                            return number;
+                                        }));
+
+    // a dashboard of counters
+    std::vector<size_t> counters(200);
+    results.push_back(measure.benchmark(
+        "draw 200 counters",
+        [&]
+        {
+            for (size_t& counter : counters)
+                counter += ++number % 7;
+            render.draw(counters, 10, 6);
+            return render.frame().size();
+        }));
+
+    results.push_back(measure.benchmark("draw<N> from constant",
+                                        [&]
+                                        {
+                                            render.draw<20'240'501>();
+                                            return render.frame().size();
+                                        }));
+
+    std::cout << benchmark_result::header() << '\n';
+    for (const auto& result : results)
+        std::cout << result.to_string() << '\n';
+
+    const auto same{[&render]<size_t Number>()
+                    {
+                        render.draw<Number>();
+                        const std::string constant{render.frame()};
+                        render.draw(Number);
+                        return constant == render.frame();
+                    }};
+    return same.template operator()<0>() &&
+           same.template operator()<20'240'501>() &&
+           same.template operator()<98'765'432'109'876'543>();
+}
+
+// Plays terminal output of LiveDisplay back into a screen of line
+// characters per line; knows just the escapes LiveDisplay sends
+inline std::string replay(std::string_view output, size_t line)
+{
+    std::string screen;
+    size_t position{0};
+    for (size_t i{0}; i < output.size();)
+    {
+        if (output[i] != '\x1b')
+        {
+            if (position >= screen.size())
+                screen.resize(position + 1, ' ');
+            screen[position++] = output[i++];
+            continue;
+        }
+
+        // ESC [ parameters final
+        const size_t last{output.find_first_of("CHJhl", i)};
+        const std::string_view parameters{output.substr(i + 2, last - i - 2)};
+        if (output[last] == 'H')
+        {
+            size_t row{1}, column{1};
+            if (const size_t semicolon{parameters.find(';')};
+                semicolon != std::string_view::npos)
+            {
+                std::from_chars(parameters.data(),
+                                parameters.data() + semicolon, row);
+                std::from_chars(parameters.data() + semicolon + 1,
+                                parameters.data() + parameters.size(), column);
+            }
+            position = (row - 1) * line + column - 1;
+        }
+        else if (output[last] == 'C')
+        {
+            size_t count{1};
+            std::from_chars(parameters.data(),
+                            parameters.data() + parameters.size(), count);
+            position += count;
+        }
+        else if (output[last] == 'J')
+            screen.clear();
+        i = last + 1;
+    }
+    return screen;
+}
+
+// Terminal traffic of a 200 counter dashboard, full frames against
+// dirty regions. The output goes to a temporary file and is played back
+// to check that the screen ends up showing the last frame.
+inline bool live_benchmark(size_t frames)
+{
+    std::FILE* file{std::tmpfile()};
+    if (file == nullptr)
+        throw std::runtime_error("[FATAL] Can't create a temporary file!");
+
+    Renderer render;
+    std::vector<size_t> counters(200, 100'000);
+    size_t full_bytes{0}, line{0};
+    std::string last_frame;
+    {
+        LiveDisplay view{30, ::fileno(file)};
+        for (size_t frame{0}; frame < frames; ++frame)
+        {
+            // counter i ticks every i % 10 + 1 frames
+            for (size_t i{0}; i < counters.size(); ++i)
+                counters[i] += (frame + i) % (i % 10 + 1) == 0;
+            render.draw(counters, 10, 6);
+            view.present(render, true);
+            full_bytes += render.frame().size();
+        }
+        last_frame = render.frame();
+        line = render.line_length();
+
+        std::cout << std::format(
+            "Live 200 counters: full frames {} bytes, dirty regions {} "
+            "bytes per frame ({:.1f}x less)\n",
+            full_bytes / frames, view.bytes() / view.frames(),
+            static_cast<double>(full_bytes) / view.bytes());
+    }
+
+    std::string output(static_cast<size_t>(std::ftell(file)), '\0');
+    std::rewind(file);
+    const size_t read{std::fread(output.data(), 1, output.size(), file)};
+    std::fclose(file);
+
+    const std::string screen{replay(std::string_view{output}.substr(0, read),
+                                    line)};
+    return screen.substr(0, last_frame.size()) == last_frame;
+}
+
+inline volatile std::sig_atomic_t interrupted{0};
+
+// Counters ticking at different rates until Ctrl+C
+inline void live_demo()
+{
+    std::signal(SIGINT, [](int) { interrupted = 1; });
+
+    Renderer render;
+    LiveDisplay view;
+    std::vector<size_t> counters(12);
+    for (size_t tick{0}; !interrupted; ++tick)
+    {
+        for (size_t i{0}; i < counters.size(); ++i)
+            counters[i] += tick % (i + 1) == 0;
+        render.draw(counters, 4, 8);
+        view.present(render);
+        std::this_thread::sleep_for(std::chrono::milliseconds{5});
+    }
+}
+
+// Converts glyph art to a font atlas. The art starts with a
+// "<width> <height>" line, then every glyph is a line holding just its
+// character followed by height lines of pixels, '#' for ink; short lines
+// are padded with blanks.
+inline std::vector<uint8_t> convert_glyph_art(std::istream& art)
+{
+    size_t width{0}, height{0};
+    std::string line;
+    if (!(art >> width >> height) || !std::getline(art, line))
+        throw std::runtime_error("[FATAL] Glyph art needs a size line!");
+
+    std::string chars;
+    // pixel rows of all glyphs
+    std::vector<std::string> rows;
+    while (std::getline(art, line))
+    {
+        if (line.size() != 1)
+            throw std::runtime_error(std::format(
+                "[FATAL] Expected a glyph character, got \"{}\"!", line));
+        chars.push_back(line[0]);
+        for (size_t y{0}; y < height; ++y)
+        {
+            if (!std::getline(art, line) || line.size() > width)
+                throw std::runtime_error(std::format(
+                    "[FATAL] Glyph '{}' needs {} rows of up to {} pixels!",
+                    chars.back(), height, width));
+            rows.push_back(line);
+        }
+    }
+
+    std::vector<uint8_t> atlas;
+    atlas.reserve(font_atlas::file_size(width, height, chars.size()));
+    write_font_atlas(
+        chars, width, height,
+        [&](size_t glyph, size_t y, size_t x)
+        {
+            const std::string& row{rows[glyph * height + y]};
+            return x < row.size() && row[x] == '#';
+        },
+        std::back_inserter(atlas));
+    return atlas;
+}
+
+// Writes the built-in digits, or the converted glyph art, as a font atlas
+inline void write_font(const std::string& path, const char* art_path)
+{
+    std::vector<uint8_t> atlas;
+    if (art_path == nullptr)
+        atlas.assign(Renderer::builtin_font().begin(),
+                     Renderer::builtin_font().end());
+    else
+    {
+        std::ifstream art{art_path};
+        if (!art)
+            throw std::runtime_error(
+                std::format("[FATAL] Can't open file \"{}\"!", art_path));
+        atlas = convert_glyph_art(art);
+    }
+
+    std::ofstream file{path, std::ios::binary};
+    file.write(reinterpret_cast<const char*>(atlas.data()),
+               static_cast<std::streamsize>(atlas.size()));
+    if (!file.flush())
+        throw std::runtime_error(
+            std::format("[FATAL] Can't write file \"{}\"!", path));
+}
+
+// The built-in digits read back from a mapped atlas file must draw the
+// same frames, and a glyph wider than a byte must come out as drawn
+inline bool font_check()
+{
+    const std::string path{
+        (std::filesystem::temp_directory_path() / "numberRenderer.rfa")
+            .string()};
+    write_font(path, nullptr);
+
+    Renderer builtin, mapped;
+    builtin.draw(1'234'567'890);
+    {
+        const mapped_font font{path};
+        mapped.set_font(font.atlas());
+        mapped.draw(1'234'567'890);
+    }
+    std::filesystem::remove(path);
+    const bool same{builtin.frame() == mapped.frame()};
+
+    std::istringstream art{"10 2\n"
+                           "A\n"
+                           "##########\n"
+                           "#        #\n"};
+    const std::vector<uint8_t> wide_font{convert_glyph_art(art)};
+    const Renderer::field text{"AA"};
+    Renderer wide;
+    wide.set_font(font_atlas{wide_font});
+    wide.draw(std::span{&text, 1});
+    return same && wide.frame() == "                       \n"
+                                   " ########## ########## \n"
+                                   " #        # #        # \n"
+                                   "                       \n";
+}
+
 int main(int argc, char* argv[])
 {
-    if (argc != 2)
+    if (argc == 2 && std::string_view{argv[1]} == "--bench")
+    {
+        const bool same_frames{render_benchmark()};
+        const bool same_screen{live_benchmark(300)};
+        return same_frames && same_screen && font_check() ? EXIT_SUCCESS
+                                                          : EXIT_FAILURE;
+    }
+    if (argc == 2 && std::string_view{argv[1]} == "--live")
+    {
+        live_demo();
+        return EXIT_SUCCESS;
+    }
+    if ((argc == 3 || argc == 4) &&
+        std::string_view{argv[1]} == "--write-font")
     {
-        std::cout << "Usage: numberRenderer <number>\twhere <number> is "
-                     "unsigned integer\n";
+        try
+        {
+            write_font(argv[2], argc == 4 ? argv[3] : nullptr);
+        }
+        catch (const std::exception& ex)
+        {
+            std::cout << std::format("{}\n", ex.what());
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+    if (argc >= 4 && std::string_view{argv[1]} == "--font")
+    {
+        try
+        {
+            const mapped_font font{argv[2]};
+            std::vector<Renderer::field> fields;
+            for (const char* text : std::span{argv + 3, argv + argc})
+                fields.push_back({text, 0, Renderer::align::left});
+
+            Renderer render;
+            render.set_font(font.atlas());
+            render.draw(fields);
+            return render.display() ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+        catch (const std::exception& ex)
+        {
+            std::cout << std::format("{}\n", ex.what());
+            return EXIT_FAILURE;
+        }
+    }
+
+    const auto is_digit{[](char ch) { return ch >= '0' && ch <= '9'; }};
+    const std::span<char*> args{argv + 1, static_cast<size_t>(argc - 1)};
+    if (args.empty() || !rng::all_of(args, [&](const char* arg)
+                                     { return rng::all_of(std::string_view{arg},
+                                                          is_digit); }))
+    {
+        std::cout << "Usage: numberRenderer <number>...\twhere <number> is "
+                     "unsigned integer\n"
+                     "       numberRenderer --bench\n"
+                     "       numberRenderer --live\n"
+                     "       numberRenderer --write-font <atlas> "
+                     "[<glyph art>]\n"
+                     "       numberRenderer --font <atlas> <text>...\n";
         return EXIT_FAILURE;
     }
 
     Renderer render;
+    if (args.size() == 1)
+        render.draw(args[0]);
+    else
+    {
+        // several numbers make a grid of up to GRID_COLUMNS columns
+        constexpr size_t GRID_COLUMNS = 3;
+        std::vector<Renderer::field> fields;
+        for (const char* arg : args)
+            fields.push_back({arg});
+        render.draw(fields, GRID_COLUMNS);
+    }
 
-    render.draw(argv[1]);
-    render.display();
-
-    return EXIT_SUCCESS;
+    return render.display() ? EXIT_SUCCESS : EXIT_FAILURE;
 }
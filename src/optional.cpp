@@ -1,10 +1,270 @@
 #include "optional.hpp"
+#include "optional_vector.hpp"
+#include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <vector>
 
-int main()
+// Layout: the value plus one flag, padded to the value's alignment
+static_assert(sizeof(my::optional<int>) == 8);
+static_assert(sizeof(my::optional<char>) == 2);
+static_assert(sizeof(my::optional<int64_t>) == 16);
+static_assert(alignof(my::optional<int64_t>) == alignof(int64_t));
+
+// Triviality follows the value type
+struct point
+{
+    int x, y;
+};
+static_assert(std::is_trivially_copyable_v<my::optional<int>>);
+static_assert(std::is_trivially_copyable_v<my::optional<point>>);
+static_assert(std::is_trivially_destructible_v<my::optional<int64_t>>);
+static_assert(std::is_trivially_copy_assignable_v<my::optional<point>>);
+static_assert(std::is_trivially_move_assignable_v<my::optional<point>>);
+static_assert(!std::is_trivially_copyable_v<my::optional<std::string>>);
+static_assert(!std::is_trivially_destructible_v<my::optional<std::string>>);
+
+// Niches: the empty state costs no space
+enum class color : uint8_t
+{
+    red,
+    green,
+    blue
+};
+
+template <>
+struct my::niche_traits<color> : my::sentinel_niche<color{0xFF}>
+{
+};
+
+// stand-in for IPaddress, octets in memory order
+struct address
+{
+    uint32_t network;
+};
+
+template <>
+struct my::niche_traits<address> : my::ipv4_niche<address>
+{
+};
+
+static_assert(sizeof(my::optional<float>) == sizeof(float));
+static_assert(sizeof(my::optional<double>) == sizeof(double));
+static_assert(sizeof(my::optional<int*>) == sizeof(int*));
+static_assert(sizeof(my::optional<color>) == sizeof(color));
+static_assert(sizeof(my::optional<address>) == sizeof(address));
+static_assert(std::is_trivially_copyable_v<my::optional<double>>);
+static_assert(std::is_trivially_copyable_v<my::optional<address>>);
+
+// Copy and move exist only where the value type has them
+static_assert(std::is_copy_constructible_v<my::optional<std::string>>);
+static_assert(std::is_nothrow_move_constructible_v<my::optional<std::string>>);
+static_assert(
+    !std::is_copy_constructible_v<my::optional<std::unique_ptr<int>>>);
+static_assert(std::is_move_assignable_v<my::optional<std::unique_ptr<int>>>);
+
+// The monadic tests live in optional_monadic.cpp, where GCC 12 gets
+// -Wno-analyzer-use-of-uninitialized-value: it reports class values
+// returned from lambdas through std::invoke as uninitialized
+void check_monadic_operations();
+
+// Heap taken by count empty elements of each layout
+template <typename _T>
+void show_footprint(std::string_view name, size_t count)
+{
+    const std::vector<my::optional<_T>> niche(count, my::optional<_T>{});
+    const std::vector<std::optional<_T>> flagged(count);
+    const auto mib{[](const auto& vector)
+                   {
+                       return static_cast<double>(vector.capacity() *
+                                                  sizeof(vector[0])) /
+                              (1 << 20);
+                   }};
+
+    std::clog << name << ": my::optional " << mib(niche)
+              << " MiB, std::optional " << mib(flagged) << " MiB\n";
+}
+
+inline void footprint_benchmark()
+{
+    constexpr size_t count{10'000'000};
+    std::clog << count << " elements\n";
+    show_footprint<float>("float", count);
+    show_footprint<double>("double", count);
+    show_footprint<int*>("int*", count);
+    show_footprint<color>("enum", count);
+    show_footprint<address>("ipv4", count);
+}
+
+// What my::optional<int> does by hand
+struct raw_int
+{
+    int value;
+    bool engaged;
+};
+
+// Without OPTIONAL_TRACE both loops compile to the same instructions,
+// compare them with objdump -d
+[[gnu::noinline]] long
+sum_optional(const std::vector<my::optional<int>>& values)
+{
+    long sum{0};
+    for (const auto& value : values)
+        if (value)
+            sum += *value;
+    return sum;
+}
+
+[[gnu::noinline]] long sum_raw(const std::vector<raw_int>& values)
+{
+    long sum{0};
+    for (const auto& value : values)
+        if (value.engaged)
+            sum += value.value;
+    return sum;
+}
+
+// Best of several passes, in ns per element
+template <typename Callable>
+double best_pass(size_t count, Callable&& func)
 {
+    using clock = std::chrono::steady_clock;
+    double best{HUGE_VAL};
+    for (int pass{0}; pass < 10; ++pass)
+    {
+        const auto start{clock::now()};
+        func();
+        const std::chrono::duration<double, std::nano> elapsed{clock::now() -
+                                                               start};
+        best = std::min(best, elapsed.count() / count);
+    }
+    return best;
+}
+
+inline bool access_benchmark()
+{
+    constexpr size_t count{10'000'000};
+    std::vector<my::optional<int>> optionals(count);
+    std::vector<raw_int> raws(count);
+    for (size_t i{0}; i < count; ++i)
+    {
+        if (i % 3 == 0)
+            continue;
+        optionals[i] = static_cast<int>(i);
+        raws[i] = {static_cast<int>(i), true};
+    }
+
+    long optional_sum{0}, raw_sum{0};
+    const double optional_time{best_pass(
+        count, [&] { optional_sum = sum_optional(optionals); })};
+    const double raw_time{
+        best_pass(count, [&] { raw_sum = sum_raw(raws); })};
+
+    std::clog << "Access: my::optional " << optional_time << " ns, raw "
+              << raw_time << " ns per element\n";
+
+    const auto triple{[](int value) noexcept { return value * 3; }};
+    std::vector<my::optional<int>> tripled(count);
+    std::vector<raw_int> raw_tripled(count);
+    const double transform_time{best_pass(
+        count, [&] { my::transform_all(optionals, tripled, triple); })};
+    const double raw_transform_time{best_pass(
+        count,
+        [&]
+        {
+            for (size_t i{0}; i < count; ++i)
+                raw_tripled[i] = raws[i].engaged
+                                     ? raw_int{triple(raws[i].value), true}
+                                     : raw_int{0, false};
+        })};
+
+    std::clog << "Transform: transform_all " << transform_time
+              << " ns, raw loop " << raw_transform_time << " ns per element\n";
+    // the last element is empty, the one before it engaged
+    return optional_sum == raw_sum && !tripled[count - 1] &&
+           tripled[count - 2] == raw_tripled[count - 2].value;
+}
+
+// Sum and filter over optional_vector against a vector of optionals. The
+// payload has no niche, so each my::optional<int64_t> takes 16 bytes.
+inline bool soa_benchmark()
+{
+    constexpr size_t count{10'000'000};
+    std::vector<my::optional<int64_t>> optionals;
+    my::optional_vector<int64_t> packed;
+    optionals.reserve(count);
+    packed.reserve(count);
+    for (size_t i{0}; i < count; ++i)
+    {
+        // every other element is empty
+        const my::optional<int64_t> item{
+            i % 2 != 0 ? my::optional<int64_t>{static_cast<int64_t>(i % 1000)}
+                       : my::optional<int64_t>{}};
+        optionals.push_back(item);
+        packed.push_back(item);
+    }
+
+    int64_t optional_sum{0}, packed_sum{0};
+    const double optional_sum_time{best_pass(count,
+                                             [&]
+                                             {
+                                                 optional_sum = 0;
+                                                 for (const auto& item :
+                                                      optionals)
+                                                     if (item)
+                                                         optional_sum += *item;
+                                             })};
+    const double packed_sum_time{
+        best_pass(count, [&] { packed_sum = packed.sum(); })};
+
+    const auto large{[](int64_t value) { return value >= 500; }};
+    size_t optional_kept{0}, packed_kept{0};
+    const double optional_filter_time{best_pass(
+        count,
+        [&]
+        {
+            std::vector<my::optional<int64_t>> kept(optionals.size());
+            for (size_t i{0}; i < optionals.size(); ++i)
+                if (optionals[i] && large(*optionals[i]))
+                    kept[i] = *optionals[i];
+            optional_kept = static_cast<size_t>(std::count_if(
+                kept.begin(), kept.end(),
+                [](const auto& item) { return item.has_value(); }));
+        })};
+    const double packed_filter_time{best_pass(
+        count,
+        [&] { packed_kept = packed.filter(large).count_engaged(); })};
+
+    std::clog << "Sum: vector<optional> " << optional_sum_time
+              << " ns, optional_vector " << packed_sum_time
+              << " ns per element\n";
+    std::clog << "Filter: vector<optional> " << optional_filter_time
+              << " ns, optional_vector " << packed_filter_time
+              << " ns per element\n";
+    return optional_sum == packed_sum && optional_kept == packed_kept;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc > 1 && std::string_view{argv[1]} == "--bench")
+    {
+        footprint_benchmark();
+        const bool access_same{access_benchmark()};
+        const bool soa_same{soa_benchmark()};
+        return access_same && soa_same ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
     my::optional<int> op_int1, op_int2(42), op_int3{my::nullopt};
     my::optional<std::string> op_string1{my::nullopt}, op_string2,
         op_string3{"Hello"};
@@ -35,6 +295,78 @@ int main()
     opt_vec->push_back(6);
     assert(opt_vec.value()[5] == 6);
 
+    my::optional<double> niche_double;
+    assert(!niche_double);
+    niche_double = std::nan("");
+    assert(niche_double && std::isnan(*niche_double));
+    niche_double.reset();
+    assert(!niche_double.has_value());
+
+    my::optional<int*> niche_pointer{static_cast<int*>(nullptr)};
+    assert(niche_pointer && *niche_pointer == nullptr);
+
+    my::optional<color> niche_color{color::blue}, no_color;
+    no_color.swap(niche_color);
+    assert(!niche_color && no_color == color::blue);
+
+    my::optional<address> niche_address{address{0x0100007F}};
+    assert(niche_address && niche_address->network == 0x0100007F);
+    niche_address = my::nullopt;
+    assert(niche_address == my::nullopt);
+
+    // trivially copyable optionals survive a memcpy
+    std::vector<my::optional<int>> ints(4), copies(4);
+    ints[1] = 7;
+    std::memcpy(copies.data(), ints.data(), ints.size() * sizeof(ints[0]));
+    assert(!copies[0] && copies[1] == 7);
+
+    my::optional<std::string> moved{std::move(op_string3)}, copied{moved};
+    assert(moved == std::string{"Hello"} && copied == std::string{"Hello"});
+    copied.swap(op_string1);
+    assert(!copied && op_string1 == std::string{"Hello"});
+    op_string2 = std::move(op_string1);
+    assert(op_string2.value() == "Hello");
+
+    my::optional<std::unique_ptr<int>> owner{std::make_unique<int>(3)},
+        other;
+    other = std::move(owner);
+    assert(**other == 3);
+
+    check_monadic_operations();
+
+    // optional_vector keeps flags in a bitmap
+    my::optional_vector<int> packed;
+    for (int i{0}; i < 130; ++i)
+        packed.push_back(i % 3 == 0 ? my::optional<int>{i}
+                                    : my::optional<int>{});
+    assert(packed.size() == 130 && packed.count_engaged() == 44);
+    assert(packed[3] && *packed[3] == 3 && !packed[4]);
+    packed[4] = 40;
+    packed[3] = my::nullopt;
+    assert(*packed[4] == 40 && !packed[3].has_value());
+    assert(packed.sum() == 129 * 44 / 2 - 3 + 40);
+    assert(packed.filter([](int value) { return value > 100; })
+               .count_engaged() == 10);
+
+    size_t engaged{0};
+    for (const auto item : packed)
+        engaged += item.has_value();
+    assert(engaged == packed.count_engaged());
+    const my::optional<int> copy{packed[4]};
+    assert(copy == 40);
+
+    // proxies assign the slot they refer to, value and flag
+    packed[5] = packed[6];
+    packed[6] = packed[3];
+    const auto& constant{packed};
+    packed[7] = constant[9];
+    packed[8] = my::optional<int>{8};
+    packed[9] = my::optional<int>{};
+    assert(*packed[5] == 6 && !packed[6] && *packed[7] == 9);
+    assert(*packed[8] == 8 && !packed[9] && packed.count_engaged() == 45);
+    static_assert(std::input_iterator<my::optional_vector<int>::iterator>);
+
+    my::trace::dump(std::clog);
     std::clog << "\e[1;32mAll asserts passed\n\e[0m";
     return EXIT_SUCCESS;
 }
@@ -1,215 +1,751 @@
-#include <iostream>
-#include <source_location>
+#pragma once
+
+// Call tracing is off unless OPTIONAL_TRACE is defined before the include
+// (the EXPERIMENTS_OPTIONAL_TRACE CMake option defines it for the optional
+// target). Off, MY_TRACE expands to nothing and every accessor is a plain
+// member access. On, each call stores its function name in a per-thread
+// ring buffer that my::trace::dump() prints; nothing is written until then.
+// The two modes live in different inline namespaces, so translation units
+// built either way link together without clashing.
+
+#include <bit>
+#include <cassert>
+#include <concepts>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <new>
+#include <ranges>
+#include <type_traits>
 #include <utility>
 
-namespace my
+#ifdef OPTIONAL_TRACE
+
+#include <array>
+#include <ostream>
+#include <source_location>
+
+namespace my::trace
+{
+// power of two
+inline constexpr size_t RING_SIZE = 4096;
+
+struct ring
+{
+    std::array<const char*, RING_SIZE> calls{};
+    size_t next{0};
+};
+
+inline ring& this_thread_ring() noexcept
 {
-#define TEST
+    thread_local ring calls;
+    return calls;
+}
+
+inline void record(const std::source_location& where) noexcept
+{
+    ring& calls{this_thread_ring()};
+    calls.calls[calls.next++ % RING_SIZE] = where.function_name();
+}
+
+// Prints this thread's last calls, oldest first
+inline void dump(std::ostream& stream)
+{
+    const ring& calls{this_thread_ring()};
+    const size_t first{calls.next > RING_SIZE ? calls.next - RING_SIZE : 0};
+    for (size_t i{first}; i < calls.next; ++i)
+        stream << calls.calls[i % RING_SIZE] << '\n';
+}
+} // namespace my::trace
+
+#define MY_TRACE ::my::trace::record(std::source_location::current())
+#define MY_OPTIONAL_ABI traced
 
-#ifndef TEST
-#define DEBUG_MSG
 #else
-#define DEBUG_MSG                                                              \
-    std::clog << std::source_location::current().function_name() << "\n";
+
+#include <iosfwd>
+
+namespace my::trace
+{
+inline void dump(std::ostream&) {}
+} // namespace my::trace
+
+#define MY_TRACE static_cast<void>(0)
+#define MY_OPTIONAL_ABI untraced
+
 #endif
 
+namespace my
+{
 constexpr struct nullopt_t
 {
 } nullopt;
 
+// Customization point: a specialization that provides
+//     static _T empty_value() noexcept;
+//     static bool is_empty(const _T&) noexcept;
+// makes optional<_T> keep its empty state inside _T itself, so
+// sizeof(optional<_T>) == sizeof(_T). The empty value can't be stored as
+// an engaged value any more: assigning it reads back as nullopt.
 template <typename _T>
-class optional final
+struct niche_traits
+{
+};
+
+// Empty is one reserved value, compared with ==. Suits enums, integers
+// and structural types such as IPaddress:
+//     template <>
+//     struct my::niche_traits<color> : my::sentinel_niche<color{255}> {};
+template <auto Sentinel>
+struct sentinel_niche
+{
+    using value_type = decltype(Sentinel);
+
+    static constexpr value_type empty_value() noexcept { return Sentinel; }
+    static constexpr bool is_empty(const value_type& value) noexcept
+    {
+        return value == Sentinel;
+    }
+};
+
+// Empty is one object representation, compared bitwise. Needed for
+// floating point, where the reserved NaN never compares equal.
+template <typename _T, auto Bits>
+    requires(sizeof(_T) == sizeof(Bits))
+struct bit_pattern_niche
+{
+    static constexpr _T empty_value() noexcept
+    {
+        return std::bit_cast<_T>(Bits);
+    }
+    static constexpr bool is_empty(const _T& value) noexcept
+    {
+        return std::bit_cast<decltype(Bits)>(value) == Bits;
+    }
+};
+
+// quiet NaNs with a payload arithmetic never produces from numbers
+template <>
+struct niche_traits<float> : bit_pattern_niche<float, uint32_t{0x7FDEAD00}>
+{
+};
+
+template <>
+struct niche_traits<double>
+    : bit_pattern_niche<double, uint64_t{0x7FFDEAD000000000}>
+{
+};
+
+// Keeps nullptr a valid engaged value; no object can start at the last
+// address, since its end would not be representable
+template <typename _T>
+struct niche_traits<_T*>
+{
+    static _T* empty_value() noexcept
+    {
+        return reinterpret_cast<_T*>(~uintptr_t{0});
+    }
+    static bool is_empty(_T* const& value) noexcept
+    {
+        return reinterpret_cast<uintptr_t>(value) == ~uintptr_t{0};
+    }
+};
+
+// the empty value gets overwritten in place, so it must need no destructor
+// For 4-byte address types that store the octets in order: the limited
+// broadcast address 255.255.255.255 is never a host address
+//     template <>
+//     struct my::niche_traits<IPaddress> : my::ipv4_niche<IPaddress> {};
+template <typename _T>
+using ipv4_niche = bit_pattern_niche<_T, uint32_t{0xFFFFFFFF}>;
+
+template <typename _T>
+concept has_niche =
+    std::is_trivially_destructible_v<_T> && requires(const _T& value) {
+        { niche_traits<_T>::empty_value() } -> std::same_as<_T>;
+        { niche_traits<_T>::is_empty(value) } -> std::same_as<bool>;
+    };
+
+inline namespace MY_OPTIONAL_ABI
+{
+template <typename _T>
+class optional;
+} // namespace MY_OPTIONAL_ABI
+
+namespace detail
+{
+template <typename _T>
+inline constexpr bool is_optional = false;
+
+template <typename _T>
+inline constexpr bool is_optional<optional<_T>> = true;
+
+// stands in for the engaged flag when the value has a niche
+struct no_flag
+{
+};
+
+// selects the constructor that builds the value from a function result
+struct invoke_tag
+{
+};
+
+// Each trivial concept refines the plain one, so when both overloads of a
+// special member are viable the defaulted (trivial) one wins
+template <typename _T>
+concept copy_constructible = std::is_copy_constructible_v<_T>;
+
+template <typename _T>
+concept trivially_copy_constructible =
+    copy_constructible<_T> && std::is_trivially_copy_constructible_v<_T>;
+
+template <typename _T>
+concept move_constructible = std::is_move_constructible_v<_T>;
+
+template <typename _T>
+concept trivially_move_constructible =
+    move_constructible<_T> && std::is_trivially_move_constructible_v<_T>;
+
+// the member-wise defaults are only right when all three are trivial
+template <typename _T>
+concept trivially_copy_assignable =
+    std::is_trivially_copy_constructible_v<_T> &&
+    std::is_trivially_copy_assignable_v<_T> &&
+    std::is_trivially_destructible_v<_T>;
+
+template <typename _T>
+concept trivially_move_assignable =
+    std::is_trivially_move_constructible_v<_T> &&
+    std::is_trivially_move_assignable_v<_T> &&
+    std::is_trivially_destructible_v<_T>;
+
+template <typename _T>
+concept trivial_payload = std::is_trivially_copyable_v<_T> &&
+                          std::is_trivially_default_constructible_v<_T>;
+
+// Holds the value without constructing it, for payloads that need their
+// constructors run
+template <typename _T>
+struct optional_storage
+{
+    union
+    {
+        char m_empty;
+        _T m_value;
+    };
+
+    optional_storage() noexcept : m_empty{} {}
+
+    ~optional_storage()
+        requires std::is_trivially_destructible_v<_T>
+    = default;
+    ~optional_storage() {}
+};
+
+// Trivial payloads are simply always alive, zero when never set. Besides
+// keeping transform_all branch free, staying out of a union lets GCC
+// vectorize loops over them.
+template <typename _T>
+    requires trivial_payload<_T>
+struct optional_storage<_T>
+{
+    _T m_value;
+
+    optional_storage() noexcept : m_value{} {}
+};
+} // namespace detail
+
+inline namespace MY_OPTIONAL_ABI
+{
+// The value is stored inline next to an engaged flag, so optional<int> is
+// 8 bytes and access is direct. Types with a niche_traits specialization
+// drop the flag and hold their empty value instead. Every special member
+// is defaulted, and therefore trivial, whenever the matching operation of
+// _T is trivial.
+template <typename _T>
+class optional final : private detail::optional_storage<_T>
 {
 private:
-    alignas(_T) char m_memory_buffer[sizeof(_T)];
-    _T* m_value_ptr;
+    static constexpr bool USES_NICHE = has_niche<_T>;
+    static constexpr bool IS_TRIVIAL = detail::trivial_payload<_T>;
 
-public:
-    optional(nullopt_t = nullopt) : m_value_ptr{nullptr} {DEBUG_MSG};
+    // Unless the payload is trivial or has a niche, m_value is alive
+    // exactly when m_engaged is set. With a niche m_engaged takes no space.
+    using detail::optional_storage<_T>::m_value;
+    [[no_unique_address]] std::conditional_t<USES_NICHE, detail::no_flag,
+                                             bool> m_engaged;
 
-    optional(_T&& val);
+    bool _engaged() const noexcept
+    {
+        if constexpr (USES_NICHE)
+            return !niche_traits<_T>::is_empty(m_value);
+        else
+            return m_engaged;
+    }
 
     template <typename... _Args>
-    optional(_Args&&... args);
+    void _construct(_Args&&... args)
+    {
+        std::construct_at(std::addressof(m_value),
+                          std::forward<_Args>(args)...);
+        if constexpr (!USES_NICHE)
+            m_engaged = true;
+    }
 
-    optional(const optional<_T>& other)
-        : m_value_ptr{new(m_memory_buffer) _T(other.value())} {DEBUG_MSG};
+    // m_value must not hold a live non-trivial value
+    void _make_empty() noexcept
+    {
+        if constexpr (USES_NICHE)
+            std::construct_at(std::addressof(m_value),
+                              niche_traits<_T>::empty_value());
+        else
+            m_engaged = false;
+    }
 
-    optional(optional<_T>&& other) noexcept { DEBUG_MSG swap(other); };
+    // Engaged with func(arg) built straight into m_value: the result is a
+    // prvalue, so it is never copied or moved
+    template <typename _F, typename _Arg>
+    optional(detail::invoke_tag, _F&& func, _Arg&& arg) : m_engaged{}
+    {
+        ::new (static_cast<void*>(std::addressof(m_value)))
+            _T(std::invoke(std::forward<_F>(func), std::forward<_Arg>(arg)));
+        if constexpr (!USES_NICHE)
+            m_engaged = true;
+    }
 
-    optional<_T>& operator=(const optional<_T>& other);
+    template <typename _Self, typename _F>
+    static auto _and_then(_Self&& self, _F&& func)
+    {
+        using result_type = std::remove_cvref_t<std::invoke_result_t<
+            _F, decltype((std::forward<_Self>(self).m_value))>>;
+        static_assert(detail::is_optional<result_type>,
+                      "and_then needs a function returning my::optional");
+
+        if (self._engaged())
+            return std::invoke(std::forward<_F>(func),
+                               std::forward<_Self>(self).m_value);
+        return result_type{};
+    }
 
-    optional<_T>&& operator=(optional<_T>&& other) noexcept;
+    template <typename _Self, typename _F>
+    static auto _transform(_Self&& self, _F&& func)
+    {
+        using result_type = std::remove_cv_t<std::invoke_result_t<
+            _F, decltype((std::forward<_Self>(self).m_value))>>;
+        static_assert(!std::is_reference_v<result_type> &&
+                          !std::is_same_v<result_type, nullopt_t>,
+                      "transform needs a function returning a value");
+
+        if (self._engaged())
+            return optional<result_type>{detail::invoke_tag{},
+                                         std::forward<_F>(func),
+                                         std::forward<_Self>(self).m_value};
+        return optional<result_type>{};
+    }
 
-    _T& operator=(const _T& value);
-    _T&& operator=(_T&& value) noexcept;
+    template <typename _U>
+    friend class optional;
 
-    ~optional() noexcept { DEBUG_MSG reset(); };
+    template <typename _In, typename _Out, typename _F>
+    friend void transform_all(const _In& in, _Out&& out, _F func);
 
-    bool has_value() const noexcept { DEBUG_MSG return m_value_ptr != nullptr; }
-    operator bool() const noexcept { DEBUG_MSG return has_value(); }
+public:
+    using value_type = _T;
 
-    _T& value() & noexcept { DEBUG_MSG return *m_value_ptr; }
-    const _T& value() const& noexcept { DEBUG_MSG return *m_value_ptr; }
+    optional(nullopt_t = nullopt) noexcept : m_engaged{}
+    {
+        MY_TRACE;
+        _make_empty();
+    };
 
-    _T&& value() && noexcept { DEBUG_MSG return *m_value_ptr; }
-    const _T&& value() const&& noexcept { DEBUG_MSG return *m_value_ptr; }
+    optional(_T&& val);
 
-    _T& operator*() & noexcept { DEBUG_MSG return value(); }
-    const _T& operator*() const& noexcept { DEBUG_MSG return value(); }
+    template <typename... _Args>
+        requires std::is_constructible_v<_T, _Args...> &&
+                 (!std::is_same_v<std::remove_cvref_t<_Args>, optional> && ...)
+    optional(_Args&&... args);
+
+    optional(const optional& other)
+        requires detail::trivially_copy_constructible<_T>
+    = default;
+    optional(const optional& other)
+        requires detail::copy_constructible<_T>
+        : m_engaged{}
+    {
+        MY_TRACE;
+        if (other._engaged())
+            _construct(other.m_value);
+        else
+            _make_empty();
+    };
+
+    optional(optional&& other) noexcept
+        requires detail::trivially_move_constructible<_T>
+    = default;
+    optional(optional&& other) noexcept(
+        std::is_nothrow_move_constructible_v<_T>)
+        requires detail::move_constructible<_T>
+        : m_engaged{}
+    {
+        MY_TRACE;
+        if (other._engaged())
+            _construct(std::move(other.m_value));
+        else
+            _make_empty();
+    };
+
+    optional& operator=(const optional& other)
+        requires detail::trivially_copy_assignable<_T>
+    = default;
+    optional& operator=(const optional& other);
+
+    optional& operator=(optional&& other) noexcept
+        requires detail::trivially_move_assignable<_T>
+    = default;
+    optional& operator=(optional&& other) noexcept(
+        std::is_nothrow_move_constructible_v<_T> &&
+        std::is_nothrow_move_assignable_v<_T>);
+
+    optional& operator=(const _T& value);
+    optional& operator=(_T&& value);
+
+    ~optional()
+        requires std::is_trivially_destructible_v<_T>
+    = default;
+    ~optional() noexcept { MY_TRACE; reset(); };
+
+    bool has_value() const noexcept { MY_TRACE; return _engaged(); }
+    operator bool() const noexcept { MY_TRACE; return has_value(); }
+
+    _T& value() & noexcept { MY_TRACE; return m_value; }
+    const _T& value() const& noexcept { MY_TRACE; return m_value; }
+
+    _T&& value() && noexcept { MY_TRACE; return std::move(m_value); }
+    const _T&& value() const&& noexcept
+    {
+        MY_TRACE; return std::move(m_value);
+    }
 
-    _T&& operator*() && noexcept { DEBUG_MSG return value(); }
-    const _T&& operator*() const&& noexcept { DEBUG_MSG return value(); }
+    _T& operator*() & noexcept { MY_TRACE; return value(); }
+    const _T& operator*() const& noexcept { MY_TRACE; return value(); }
 
-    _T* operator->() & noexcept { DEBUG_MSG return m_value_ptr; }
-    const _T* operator->() const& noexcept { DEBUG_MSG return m_value_ptr; }
+    _T&& operator*() && noexcept { MY_TRACE; return std::move(*this).value(); }
+    const _T&& operator*() const&& noexcept
+    {
+        MY_TRACE; return std::move(*this).value();
+    }
 
-    _T* operator->() && noexcept { DEBUG_MSG return m_value_ptr; }
-    const _T* operator->() const&& noexcept { DEBUG_MSG return m_value_ptr; }
+    _T* operator->() noexcept { MY_TRACE; return std::addressof(m_value); }
+    const _T* operator->() const noexcept
+    {
+        MY_TRACE; return std::addressof(m_value);
+    }
 
     void reset() noexcept;
 
-    void swap(optional& other) & noexcept
+    void swap(optional& other) noexcept(
+        std::is_nothrow_move_constructible_v<_T> &&
+        std::is_nothrow_swappable_v<_T>);
+
+    template <typename... _Args>
+    _T& emplace(_Args&&... args);
+
+    // the value, or default_value converted to _T when empty
+    template <typename _U>
+    _T value_or(_U&& default_value) const&
     {
-        DEBUG_MSG
-        std::swap(this->val, other.val);
-        std::swap(this->buf, other.buf);
+        MY_TRACE;
+        return _engaged() ? m_value
+                          : static_cast<_T>(std::forward<_U>(default_value));
     }
-    void swap(optional&& other) && noexcept
+    template <typename _U>
+    _T value_or(_U&& default_value) &&
     {
-        DEBUG_MSG
-        std::swap(this->val, other.val);
-        std::swap(this->buf, other.buf);
+        MY_TRACE;
+        return _engaged() ? std::move(m_value)
+                          : static_cast<_T>(std::forward<_U>(default_value));
     }
 
-    template <typename... _Args>
-    void emplace(_Args&&... args);
+    // func(value), which must return a my::optional, or an empty one
+    template <typename _F>
+    auto and_then(_F&& func) &
+    {
+        MY_TRACE;
+        return _and_then(*this, std::forward<_F>(func));
+    }
+    template <typename _F>
+    auto and_then(_F&& func) const&
+    {
+        MY_TRACE;
+        return _and_then(*this, std::forward<_F>(func));
+    }
+    template <typename _F>
+    auto and_then(_F&& func) &&
+    {
+        MY_TRACE;
+        return _and_then(std::move(*this), std::forward<_F>(func));
+    }
+    template <typename _F>
+    auto and_then(_F&& func) const&&
+    {
+        MY_TRACE;
+        return _and_then(std::move(*this), std::forward<_F>(func));
+    }
+
+    // optional holding func(value), or an empty one. On an rvalue the
+    // value is passed as an rvalue, so chains can move it through.
+    template <typename _F>
+    auto transform(_F&& func) &
+    {
+        MY_TRACE;
+        return _transform(*this, std::forward<_F>(func));
+    }
+    template <typename _F>
+    auto transform(_F&& func) const&
+    {
+        MY_TRACE;
+        return _transform(*this, std::forward<_F>(func));
+    }
+    template <typename _F>
+    auto transform(_F&& func) &&
+    {
+        MY_TRACE;
+        return _transform(std::move(*this), std::forward<_F>(func));
+    }
+    template <typename _F>
+    auto transform(_F&& func) const&&
+    {
+        MY_TRACE;
+        return _transform(std::move(*this), std::forward<_F>(func));
+    }
+
+    // this when engaged, otherwise func(), which must return optional<_T>
+    template <typename _F>
+        requires std::is_copy_constructible_v<_T>
+    optional or_else(_F&& func) const&
+    {
+        MY_TRACE;
+        return _engaged() ? *this : std::invoke(std::forward<_F>(func));
+    }
+    template <typename _F>
+    optional or_else(_F&& func) &&
+    {
+        MY_TRACE;
+        return _engaged() ? std::move(*this)
+                          : std::invoke(std::forward<_F>(func));
+    }
 };
 
-template <typename _T>
-optional<_T>::optional(_T&& val)
+// out[i] = in[i].transform(func) for the first size(in) elements of the
+// contiguous ranges in and out. For arithmetic payloads func runs on every
+// element, empty ones reading as a value-initialized _T, which leaves a
+// branch-free loop the compiler can vectorize; func must then be noexcept,
+// free of side effects and defined for every value of the payload type.
+// Other payloads, pointers included, take the branching path.
+template <typename _In, typename _Out, typename _F>
+void transform_all(const _In& in, _Out&& out, _F func)
 {
-    DEBUG_MSG
-    this->m_value_ptr = new (m_memory_buffer) _T(std::forward<_T>(val));
+    MY_TRACE;
+    using input_type = std::ranges::range_value_t<_In>;
+    using output_type = std::ranges::range_value_t<_Out>;
+    using value_type = typename input_type::value_type;
+    using result_type = typename output_type::value_type;
+    static_assert(std::is_same_v<input_type, optional<value_type>>);
+    static_assert(std::is_same_v<output_type, optional<result_type>>);
+
+    const input_type* source{std::ranges::data(in)};
+    output_type* target{std::ranges::data(out)};
+    const size_t count{std::ranges::size(in)};
+    assert(std::ranges::size(out) >= count);
+
+    constexpr bool branch_free{
+        std::is_arithmetic_v<value_type> &&
+        (input_type::IS_TRIVIAL || input_type::USES_NICHE) &&
+        std::is_trivially_copyable_v<result_type> &&
+        std::is_nothrow_invocable_v<_F&, const value_type&>};
+    for (size_t i{0}; i < count; ++i)
+    {
+        if constexpr (branch_free)
+        {
+            const bool engaged{source[i]._engaged()};
+            // never the niche or a stale value left by reset()
+            const value_type value{engaged ? source[i].m_value
+                                           : value_type{}};
+            const result_type result(std::invoke(func, value));
+            if constexpr (output_type::USES_NICHE)
+                target[i].m_value =
+                    engaged ? result : niche_traits<result_type>::empty_value();
+            else
+            {
+                target[i].m_value = result;
+                target[i].m_engaged = engaged;
+            }
+        }
+        else
+            target[i] = source[i].transform(func);
+    }
 }
 
 template <typename _T>
-inline optional<_T>& optional<_T>::operator=(const optional<_T>& other)
+optional<_T>::optional(_T&& val) : m_engaged{}
 {
-    DEBUG_MSG
-    reset();
-    m_value_ptr = new (m_memory_buffer) _T(other.value());
-    return *this;
+    MY_TRACE;
+    _construct(std::move(val));
 }
 
 template <typename _T>
-inline optional<_T>&& optional<_T>::operator=(optional<_T>&& other) noexcept
+template <typename... _Args>
+    requires std::is_constructible_v<_T, _Args...> &&
+             (!std::is_same_v<std::remove_cvref_t<_Args>, optional<_T>> && ...)
+inline optional<_T>::optional(_Args&&... args) : m_engaged{}
 {
-    DEBUG_MSG
-    swap(other);
-    return std::move(*this);
+    MY_TRACE;
+    _construct(std::forward<_Args>(args)...);
 }
 
 template <typename _T>
-inline _T& optional<_T>::operator=(const _T& value)
+inline optional<_T>& optional<_T>::operator=(const optional& other)
 {
-    DEBUG_MSG
-    if (m_memory_buffer == nullptr)
-        m_value_ptr = new (m_memory_buffer) _T(value);
+    MY_TRACE;
+    if (!other._engaged())
+        reset();
+    else if (_engaged())
+        m_value = other.m_value;
     else
-        *m_value_ptr = value;
+        _construct(other.m_value);
+    return *this;
+}
 
-    return *m_value_ptr;
+template <typename _T>
+inline optional<_T>& optional<_T>::operator=(optional&& other) noexcept(
+    std::is_nothrow_move_constructible_v<_T> &&
+    std::is_nothrow_move_assignable_v<_T>)
+{
+    MY_TRACE;
+    if (!other._engaged())
+        reset();
+    else if (_engaged())
+        m_value = std::move(other.m_value);
+    else
+        _construct(std::move(other.m_value));
+    return *this;
 }
 
 template <typename _T>
-inline _T&& optional<_T>::operator=(_T&& value) noexcept
+inline optional<_T>& optional<_T>::operator=(const _T& value)
 {
-    DEBUG_MSG
-    if (!m_value_ptr)
-        m_value_ptr = new (m_memory_buffer) _T(std::forward<_T>(value));
+    MY_TRACE;
+    if (_engaged())
+        m_value = value;
     else
-        std::swap(*m_value_ptr, value);
+        _construct(value);
+    return *this;
+}
 
-    return std::move(*m_value_ptr);
+template <typename _T>
+inline optional<_T>& optional<_T>::operator=(_T&& value)
+{
+    MY_TRACE;
+    if (_engaged())
+        m_value = std::move(value);
+    else
+        _construct(std::move(value));
+    return *this;
 }
 
 template <typename _T>
 inline void optional<_T>::reset() noexcept
 {
-    DEBUG_MSG
-    if (m_value_ptr != nullptr)
+    MY_TRACE;
+    if (_engaged())
     {
-        m_value_ptr->~_T();
-        m_value_ptr = nullptr;
+        std::destroy_at(std::addressof(m_value));
+        _make_empty();
     }
 }
 
 template <typename _T>
-template <typename... _Args>
-inline optional<_T>::optional(_Args&&... args)
+inline void optional<_T>::swap(optional& other) noexcept(
+    std::is_nothrow_move_constructible_v<_T> &&
+    std::is_nothrow_swappable_v<_T>)
 {
-    DEBUG_MSG
-    m_value_ptr = new (m_memory_buffer) _T(std::forward<_Args>(args)...);
+    MY_TRACE;
+    if (_engaged() && other._engaged())
+    {
+        using std::swap;
+        swap(m_value, other.m_value);
+    }
+    else if (_engaged())
+    {
+        other._construct(std::move(m_value));
+        reset();
+    }
+    else if (other._engaged())
+    {
+        _construct(std::move(other.m_value));
+        other.reset();
+    }
 }
 
 template <typename _T>
 template <typename... _Args>
-void optional<_T>::emplace(_Args&&... args)
+_T& optional<_T>::emplace(_Args&&... args)
 {
-    DEBUG_MSG
+    MY_TRACE;
     reset();
-    m_value_ptr = new (m_memory_buffer) _T(std::forward<_Args>(args)...);
+    _construct(std::forward<_Args>(args)...);
+    return m_value;
 }
 
 template <typename _T>
 bool operator==(const my::optional<_T>& obj, const my::nullopt_t) noexcept
 {
-    DEBUG_MSG
+    MY_TRACE;
     return !obj.has_value();
 }
 
 template <typename _T>
 bool operator!=(const my::optional<_T>& obj, const my::nullopt_t) noexcept
 {
-    DEBUG_MSG
+    MY_TRACE;
     return obj.has_value();
 }
 
 template <typename _T>
 bool operator==(const my::nullopt_t, const my::optional<_T>& obj) noexcept
 {
-    DEBUG_MSG
+    MY_TRACE;
     return !obj.has_value();
 }
 
 template <typename _T>
 bool operator!=(const my::nullopt_t, const my::optional<_T>& obj) noexcept
 {
-    DEBUG_MSG
+    MY_TRACE;
     return obj.has_value();
 }
 
 template <typename _T>
 bool operator==(const my::optional<_T>& opt, const _T& val) noexcept
 {
-    return opt.value() == val;
+    return opt.has_value() && opt.value() == val;
 }
 
 template <typename _T>
 bool operator==(const my::optional<_T>& opt, const _T&& val) noexcept
 {
-    return opt.value() == val;
+    return opt.has_value() && opt.value() == val;
 }
 
+} // namespace MY_OPTIONAL_ABI
 } // namespace my
 
 template <typename _T>
 struct std::hash<my::optional<_T>>
 {
-    std::size_t operator()(const my::optional<_T>& obj) noexcept
+    std::size_t operator()(const my::optional<_T>& obj) const noexcept
     {
-        DEBUG_MSG
-        return std::hash<_T>::operator()(obj.value());
+        MY_TRACE;
+        return obj.has_value() ? std::hash<_T>{}(obj.value()) : 0;
     }
 };
@@ -0,0 +1,141 @@
+#include "optional.hpp"
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+// Allocations made through counting_allocator, of any type
+static size_t allocation_count{0};
+
+// std::allocator that counts, for the containers whose allocations the
+// tests check
+template <typename _T>
+struct counting_allocator
+{
+    using value_type = _T;
+
+    counting_allocator() = default;
+    template <typename _U>
+    counting_allocator(const counting_allocator<_U>&) noexcept
+    {
+    }
+
+    _T* allocate(size_t count)
+    {
+        ++allocation_count;
+        return std::allocator<_T>{}.allocate(count);
+    }
+    void deallocate(_T* memory, size_t count) noexcept
+    {
+        std::allocator<_T>{}.deallocate(memory, count);
+    }
+
+    template <typename _U>
+    bool operator==(const counting_allocator<_U>&) const noexcept
+    {
+        return true;
+    }
+};
+
+using counted_string =
+    std::basic_string<char, std::char_traits<char>, counting_allocator<char>>;
+using counted_vector = std::vector<int, counting_allocator<int>>;
+
+// Counts its copies, moves are free
+struct counted
+{
+    static inline size_t copies{0};
+    int value;
+
+    explicit counted(int init) : value{init} {}
+    counted(const counted& other) : value{other.value} { ++copies; }
+    counted(counted&&) noexcept = default;
+    counted& operator=(const counted& other)
+    {
+        value = other.value;
+        ++copies;
+        return *this;
+    }
+    counted& operator=(counted&&) noexcept = default;
+};
+
+void check_monadic_operations()
+{
+    // Chains on an rvalue move the payload through: no copies, no
+    // allocations
+    my::optional<counted_string> text{counted_string(100, 'x')};
+    size_t allocations_before{allocation_count};
+    const size_t length{std::move(text)
+                            .transform(
+                                [](counted_string&& str)
+                                {
+                                    str.back() = 'y';
+                                    return std::move(str);
+                                })
+                            .and_then(
+                                [](counted_string&& str)
+                                { return my::optional<size_t>{str.size()}; })
+                            .value_or(size_t{0})};
+    assert(length == 100 && allocation_count == allocations_before);
+
+    my::optional<counted_vector> numbers{counted_vector(1000, 1)};
+    allocations_before = allocation_count;
+    auto doubled{std::move(numbers).transform(
+        [](counted_vector&& vector)
+        {
+            for (int& number : vector)
+                number *= 2;
+            return std::move(vector);
+        })};
+    const counted_vector kept{std::move(doubled).value_or(counted_vector{})};
+    assert(allocation_count == allocations_before && kept[999] == 2);
+
+    my::optional<std::vector<int>> none;
+    const std::vector<int> seven{7};
+    const auto fallback{std::move(none).or_else(
+        [&] { return my::optional<std::vector<int>>{seven}; })};
+    assert(fallback->front() == 7);
+    assert(!none.transform([](const std::vector<int>& vector)
+                           { return vector.size(); }));
+
+    counted::copies = 0;
+    my::optional<counted> source{counted{1}};
+    const auto result{std::move(source)
+                          .transform(
+                              [](counted&& item)
+                              {
+                                  ++item.value;
+                                  return std::move(item);
+                              })
+                          .transform([](counted&& item)
+                                     { return counted{item.value * 10}; })};
+    assert(result->value == 20 && counted::copies == 0);
+
+    // transform_all, branch free and generic
+    std::vector<my::optional<int>> inputs(8), outputs(8);
+    inputs[2] = 5;
+    my::transform_all(inputs, outputs, [](int value) noexcept
+                      { return value * 3; });
+    assert(outputs[2] == 15 && !outputs[0]);
+
+    std::vector<my::optional<double>> halves(8);
+    my::transform_all(inputs, halves, [](int value) noexcept
+                      { return value / 2.0; });
+    assert(halves[2] == 2.5 && !halves[1]);
+
+    std::vector<my::optional<std::string>> names(3);
+    my::transform_all(std::span{inputs}.first(3), names,
+                      [](int value) { return std::to_string(value); });
+    assert(names[2] == std::string{"5"} && !names[0]);
+
+    // the empty slot holds the pointer niche, func must never see it
+    int target{7};
+    std::vector<my::optional<int*>> pointers(2);
+    pointers[0] = &target;
+    std::vector<my::optional<int>> targets(2);
+    my::transform_all(pointers, targets, [](int* pointer) noexcept
+                      { return *pointer; });
+    assert(targets[0] == 7 && !targets[1]);
+}
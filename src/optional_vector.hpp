@@ -0,0 +1,328 @@
+#pragma once
+
+#include "optional.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace my
+{
+// Many optionals as a struct of arrays: the payloads sit contiguously in
+// one vector and the engaged flags in a bitmap, one bit per element, so
+// optional_vector<int64_t> takes 8 bytes and a bit per element instead of
+// the 16 of my::optional<int64_t>. Empty slots hold a value-initialized _T,
+// which lets reductions read every slot without branching.
+template <typename _T>
+class optional_vector final
+{
+    static_assert(!std::is_same_v<_T, bool>,
+                  "std::vector<bool> has no contiguous storage");
+    static_assert(std::is_default_constructible_v<_T>);
+
+    template <bool _Const>
+    class basic_iterator;
+
+public:
+    // Stands in for my::optional<_T&>: refers to one slot of the vector
+    template <bool _Const>
+    class basic_reference
+    {
+    public:
+        using value_pointer = std::conditional_t<_Const, const _T*, _T*>;
+        using word_pointer =
+            std::conditional_t<_Const, const uint64_t*, uint64_t*>;
+
+        basic_reference(value_pointer value, word_pointer word,
+                        uint64_t bit) noexcept
+            : m_value{value}, m_word{word}, m_bit{bit}
+        {
+        }
+
+        bool has_value() const noexcept { return (*m_word & m_bit) != 0; }
+        explicit operator bool() const noexcept { return has_value(); }
+
+        value_pointer operator->() const noexcept { return m_value; }
+        auto& operator*() const noexcept { return *m_value; }
+        auto& value() const noexcept { return *m_value; }
+
+        _T value_or(const _T& default_value) const
+        {
+            return has_value() ? *m_value : default_value;
+        }
+
+        operator optional<_T>() const
+        {
+            return has_value() ? optional<_T>{*m_value} : optional<_T>{};
+        }
+
+        basic_reference(const basic_reference&) = default;
+
+        // Assigning a proxy copies the slot it refers to, like
+        // std::vector<bool>::reference, rather than rebinding
+        const basic_reference& operator=(const basic_reference& other) const
+            requires(!_Const)
+        {
+            return _assign(other);
+        }
+
+        const basic_reference&
+        operator=(const basic_reference<!_Const>& other) const
+            requires(!_Const)
+        {
+            return _assign(other);
+        }
+
+        const basic_reference& operator=(const optional<_T>& other) const
+            requires(!_Const)
+        {
+            return _assign(other);
+        }
+
+        const basic_reference& operator=(const _T& value) const
+            requires(!_Const)
+        {
+            *m_value = value;
+            *m_word |= m_bit;
+            return *this;
+        }
+
+        const basic_reference& operator=(nullopt_t) const
+            requires(!_Const)
+        {
+            reset();
+            return *this;
+        }
+
+        void reset() const
+            requires(!_Const)
+        {
+            *m_value = _T{};
+            *m_word &= ~m_bit;
+        }
+
+    private:
+        template <typename _Source>
+        const basic_reference& _assign(const _Source& source) const
+        {
+            if (source)
+                *this = *source;
+            else
+                reset();
+            return *this;
+        }
+
+        value_pointer m_value;
+        word_pointer m_word;
+        uint64_t m_bit;
+    };
+
+    using value_type = optional<_T>;
+    using reference = basic_reference<false>;
+    using const_reference = basic_reference<true>;
+    using iterator = basic_iterator<false>;
+    using const_iterator = basic_iterator<true>;
+
+    optional_vector() = default;
+
+    explicit optional_vector(size_t count)
+        : m_values(count), m_engaged(_words(count)), m_size{count}
+    {
+    }
+
+    size_t size() const noexcept { return m_size; }
+    bool empty() const noexcept { return m_size == 0; }
+
+    void reserve(size_t count)
+    {
+        m_values.reserve(count);
+        m_engaged.reserve(_words(count));
+    }
+
+    void push_back(const optional<_T>& item)
+    {
+        if (item)
+            push_back(*item);
+        else
+            push_back(nullopt);
+    }
+
+    void push_back(const _T& value)
+    {
+        m_values.push_back(value);
+        _grow();
+        m_engaged.back() |= _bit(m_size - 1);
+    }
+
+    void push_back(nullopt_t)
+    {
+        m_values.emplace_back();
+        _grow();
+    }
+
+    reference operator[](size_t index) noexcept
+    {
+        assert(index < m_size);
+        return {&m_values[index], &m_engaged[index / 64], _bit(index)};
+    }
+
+    const_reference operator[](size_t index) const noexcept
+    {
+        assert(index < m_size);
+        return {&m_values[index], &m_engaged[index / 64], _bit(index)};
+    }
+
+    iterator begin() noexcept { return {this, 0}; }
+    iterator end() noexcept { return {this, m_size}; }
+    const_iterator begin() const noexcept { return {this, 0}; }
+    const_iterator end() const noexcept { return {this, m_size}; }
+
+    // Raw views: slots of empty elements hold _T{}
+    const _T* values() const noexcept { return m_values.data(); }
+    const uint64_t* engaged_bits() const noexcept { return m_engaged.data(); }
+
+    size_t count_engaged() const noexcept
+    {
+        size_t count{0};
+        for (const uint64_t word : m_engaged)
+            count += static_cast<size_t>(std::popcount(word));
+        return count;
+    }
+
+    // op folded over the engaged values, identity for an empty vector.
+    // Empty slots feed identity instead of a branch, and LANES independent
+    // accumulators break the dependency chain, so the loop vectorizes even
+    // for floating point. The grouping differs from a left fold, so op
+    // must be associative and commutative.
+    template <typename _BinaryOp>
+    _T reduce(_T identity, _BinaryOp op) const
+    {
+        std::array<_T, LANES> partial;
+        partial.fill(identity);
+
+        for (size_t first{0}; first < m_size; first += 64)
+        {
+            const uint64_t bits{m_engaged[first / 64]};
+            const _T* values{m_values.data() + first};
+            const size_t count{std::min<size_t>(64, m_size - first)};
+            for (size_t i{0}; i < count; ++i)
+            {
+                const bool engaged{(bits >> i & 1) != 0};
+                partial[i % LANES] =
+                    op(partial[i % LANES], engaged ? values[i] : identity);
+            }
+        }
+
+        _T result{identity};
+        for (const _T& lane : partial)
+            result = op(result, lane);
+        return result;
+    }
+
+    _T sum() const { return reduce(_T{}, std::plus<>{}); }
+
+    // Copy where elements failing pred are empty. pred runs on every slot,
+    // empty ones included, and the result is and-ed into the bitmap, so
+    // pred should be cheap and free of side effects.
+    template <typename _Pred>
+    optional_vector filter(_Pred pred) const
+    {
+        optional_vector result;
+        result.m_size = m_size;
+        result.m_engaged.resize(m_engaged.size());
+        result.m_values.resize(m_size);
+
+        for (size_t first{0}; first < m_size; first += 64)
+        {
+            const _T* values{m_values.data() + first};
+            const size_t count{std::min<size_t>(64, m_size - first)};
+            uint64_t keep{0};
+            for (size_t i{0}; i < count; ++i)
+                keep |= uint64_t{static_cast<bool>(pred(values[i]))} << i;
+
+            const uint64_t bits{m_engaged[first / 64] & keep};
+            result.m_engaged[first / 64] = bits;
+            _T* kept{result.m_values.data() + first};
+            for (size_t i{0}; i < count; ++i)
+                kept[i] = (bits >> i & 1) ? values[i] : _T{};
+        }
+        return result;
+    }
+
+private:
+    // accumulators in reduce(), enough for two AVX registers of float
+    static constexpr size_t LANES = 16;
+
+    std::vector<_T> m_values;
+    std::vector<uint64_t> m_engaged;
+    size_t m_size{0};
+
+    static constexpr size_t _words(size_t count) noexcept
+    {
+        return (count + 63) / 64;
+    }
+
+    static constexpr uint64_t _bit(size_t index) noexcept
+    {
+        return uint64_t{1} << (index % 64);
+    }
+
+    // after a payload was appended
+    void _grow()
+    {
+        if (m_size % 64 == 0)
+            m_engaged.push_back(0);
+        ++m_size;
+    }
+};
+
+// Walks the slots, dereferencing to a reference proxy
+template <typename _T>
+template <bool _Const>
+class optional_vector<_T>::basic_iterator
+{
+public:
+    using container =
+        std::conditional_t<_Const, const optional_vector, optional_vector>;
+    using value_type = optional<_T>;
+    using reference = basic_reference<_Const>;
+    using difference_type = std::ptrdiff_t;
+    using iterator_category = std::input_iterator_tag;
+
+    basic_iterator() = default;
+    basic_iterator(container* owner, size_t index) noexcept
+        : m_owner{owner}, m_index{index}
+    {
+    }
+
+    reference operator*() const noexcept { return (*m_owner)[m_index]; }
+
+    basic_iterator& operator++() noexcept
+    {
+        ++m_index;
+        return *this;
+    }
+    basic_iterator operator++(int) noexcept
+    {
+        basic_iterator old{*this};
+        ++m_index;
+        return old;
+    }
+
+    bool operator==(const basic_iterator& other) const noexcept
+    {
+        return m_index == other.m_index;
+    }
+
+private:
+    container* m_owner{nullptr};
+    size_t m_index{0};
+};
+} // namespace my
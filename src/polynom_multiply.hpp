@@ -0,0 +1,434 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// Products of polynomials given as coefficient arrays, index i holding
+// the coefficient of power i. Coefficients are 64 bit and results wrap
+// modulo 2^64 like unsigned arithmetic, so every method returns the same
+// bits and a result is exact whenever it fits into int64_t.
+namespace polynom_multiply
+{
+enum class method
+{
+    schoolbook,
+    karatsuba,
+    ntt
+};
+
+// Below this many coefficients in the shorter factor Karatsuba recursion
+// stops and the schoolbook loop takes over
+inline constexpr size_t KARATSUBA_MIN = 32;
+// From this many coefficients in the shorter factor on the transform wins
+inline constexpr size_t NTT_MIN = 2048;
+// The transform works modulo three primes whose product exceeds 2^85, so
+// it needs coefficients in int32_t range and at most NTT_MAX_FACTOR
+// coefficients in the shorter factor to recover exact sums of products.
+// Its length is limited by the largest power of two dividing p - 1.
+inline constexpr size_t NTT_MAX_FACTOR = size_t{1} << 22;
+inline constexpr size_t NTT_MAX_LENGTH = size_t{1} << 24;
+// Transforms shorter than this are not worth a thread
+inline constexpr size_t PARALLEL_MIN = size_t{1} << 16;
+} // namespace polynom_multiply
+
+namespace polynom_detail
+{
+inline bool fits_int32(std::span<const int64_t> coefficients) noexcept
+{
+    return std::ranges::all_of(
+        coefficients,
+        [](int64_t value) { return value >= INT32_MIN && value <= INT32_MAX; });
+}
+
+// out[0, n + m - 1) += a * b
+inline void schoolbook(const uint64_t* a, size_t n, const uint64_t* b,
+                       size_t m, uint64_t* out) noexcept
+{
+    for (size_t i{0}; i < n; ++i)
+    {
+        const uint64_t factor{a[i]};
+        uint64_t* row{out + i};
+        for (size_t j{0}; j < m; ++j)
+            row[j] += factor * b[j];
+    }
+}
+
+// out[0, n + m - 1) += a * b with n >= m
+inline void karatsuba(const uint64_t* a, size_t n, const uint64_t* b,
+                      size_t m, uint64_t* out)
+{
+    if (m < polynom_multiply::KARATSUBA_MIN)
+    {
+        schoolbook(a, n, b, m, out);
+        return;
+    }
+    if (m <= n / 2)
+    {
+        // far from square: m long slices of a, each a balanced product
+        for (size_t first{0}; first < n; first += m)
+        {
+            const size_t length{std::min(m, n - first)};
+            if (length >= m)
+                karatsuba(a + first, length, b, m, out + first);
+            else
+                karatsuba(b, m, a + first, length, out + first);
+        }
+        return;
+    }
+
+    // a = a0 + a1 x^half, b = b0 + b1 x^half, then
+    // a b = z0 + ((a0 + a1)(b0 + b1) - z0 - z2) x^half + z2 x^(2 half)
+    const size_t half{n / 2};
+    const size_t a_high{n - half}, b_high{m - half};
+    const size_t a_sum_size{std::max(half, a_high)};
+    const size_t b_sum_size{std::max(half, b_high)};
+
+    std::vector<uint64_t> z0(2 * half - 1);
+    std::vector<uint64_t> z2(a_high + b_high - 1);
+    std::vector<uint64_t> a_sum(a_sum_size), b_sum(b_sum_size);
+    std::vector<uint64_t> z1(a_sum_size + b_sum_size - 1);
+
+    karatsuba(a, half, b, half, z0.data());
+    if (a_high >= b_high)
+        karatsuba(a + half, a_high, b + half, b_high, z2.data());
+    else
+        karatsuba(b + half, b_high, a + half, a_high, z2.data());
+
+    std::copy_n(a, half, a_sum.begin());
+    for (size_t i{0}; i < a_high; ++i)
+        a_sum[i] += a[half + i];
+    std::copy_n(b, half, b_sum.begin());
+    for (size_t i{0}; i < b_high; ++i)
+        b_sum[i] += b[half + i];
+    if (a_sum_size >= b_sum_size)
+        karatsuba(a_sum.data(), a_sum_size, b_sum.data(), b_sum_size,
+                  z1.data());
+    else
+        karatsuba(b_sum.data(), b_sum_size, a_sum.data(), a_sum_size,
+                  z1.data());
+
+    for (size_t i{0}; i < z0.size(); ++i)
+    {
+        out[i] += z0[i];
+        z1[i] -= z0[i];
+    }
+    for (size_t i{0}; i < z2.size(); ++i)
+    {
+        out[2 * half + i] += z2[i];
+        z1[i] -= z2[i];
+    }
+    for (size_t i{0}; i < z1.size(); ++i)
+        out[half + i] += z1[i];
+}
+
+// Arithmetic modulo Prime with Root generating its multiplicative group.
+// The transform keeps values in Montgomery form, x 2^32 mod Prime, where
+// a product needs no division; the rest runs rarely and uses plain %.
+template <uint32_t Prime, uint32_t Root>
+struct ntt_field
+{
+    static_assert(Prime % 2 == 1 && Prime < (uint32_t{1} << 31));
+    static constexpr uint32_t PRIME = Prime;
+
+    // -Prime^-1 mod 2^32 by Newton's iteration, each step doubles the
+    // correct low bits
+    static constexpr uint32_t NEGATIVE_INVERSE = []
+    {
+        uint32_t inverse{Prime};
+        for (int i{0}; i < 5; ++i)
+            inverse *= 2 - Prime * inverse;
+        return 0 - inverse;
+    }();
+    // 2^64 mod Prime, turns a plain value into Montgomery form
+    static constexpr uint32_t R_SQUARED = static_cast<uint32_t>(
+        ((uint64_t{1} << 32) % Prime) * ((uint64_t{1} << 32) % Prime) % Prime);
+
+    // value 2^-32 mod Prime for value < Prime 2^32
+    static constexpr uint32_t redc(uint64_t value) noexcept
+    {
+        const uint32_t m{static_cast<uint32_t>(value) * NEGATIVE_INVERSE};
+        const auto result{
+            static_cast<uint32_t>((value + uint64_t{m} * Prime) >> 32)};
+        return result >= Prime ? result - Prime : result;
+    }
+
+    // a b 2^-32, so Montgomery forms multiply into a Montgomery form and
+    // a Montgomery form times a plain value gives a plain value
+    static constexpr uint32_t montgomery_multiply(uint32_t a,
+                                                  uint32_t b) noexcept
+    {
+        return redc(uint64_t{a} * b);
+    }
+
+    static constexpr uint32_t to_montgomery(uint32_t value) noexcept
+    {
+        return montgomery_multiply(value, R_SQUARED);
+    }
+
+    static constexpr uint32_t multiply(uint32_t a, uint32_t b) noexcept
+    {
+        return static_cast<uint32_t>(uint64_t{a} * b % Prime);
+    }
+
+    static constexpr uint32_t power(uint32_t base, uint64_t exponent) noexcept
+    {
+        uint32_t result{1};
+        for (; exponent != 0; exponent >>= 1, base = multiply(base, base))
+            if (exponent & 1)
+                result = multiply(result, base);
+        return result;
+    }
+
+    static constexpr uint32_t inverse(uint32_t value) noexcept
+    {
+        return power(value, Prime - 2);
+    }
+
+    static constexpr uint32_t reduce(int64_t value) noexcept
+    {
+        const int64_t rest{value % static_cast<int64_t>(Prime)};
+        return static_cast<uint32_t>(rest < 0 ? rest + Prime : rest);
+    }
+
+    // Montgomery forms of a primitive 2^k-th root of unity, or of its
+    // inverse, at index k for every 2^k dividing Prime - 1
+    static constexpr std::array<uint32_t, 32> roots(bool inverse_roots)
+    {
+        std::array<uint32_t, 32> result{};
+        for (size_t k{0}; k < 32 && (Prime - 1) % (uint64_t{1} << k) == 0;
+             ++k)
+        {
+            const uint32_t root{power(Root, (Prime - 1) >> k)};
+            result[k] = to_montgomery(inverse_roots ? inverse(root) : root);
+        }
+        return result;
+    }
+    static constexpr std::array<uint32_t, 32> ROOTS = roots(false);
+    static constexpr std::array<uint32_t, 32> INVERSE_ROOTS = roots(true);
+
+    // In place transform of Montgomery forms, a power of two of them.
+    // The inverse leaves out the division by the length.
+    static void transform(std::vector<uint32_t>& values,
+                          bool inverse_transform)
+    {
+        const size_t length{values.size()};
+        for (size_t i{1}, j{0}; i < length; ++i)
+        {
+            size_t bit{length >> 1};
+            for (; j & bit; bit >>= 1)
+                j ^= bit;
+            j ^= bit;
+            if (i < j)
+                std::swap(values[i], values[j]);
+        }
+
+        std::vector<uint32_t> powers(length / 2);
+        for (size_t span{1}, order{1}; span < length; span *= 2, ++order)
+        {
+            const uint32_t step{inverse_transform ? INVERSE_ROOTS[order]
+                                                  : ROOTS[order]};
+            powers[0] = to_montgomery(1);
+            for (size_t k{1}; k < span; ++k)
+                powers[k] = montgomery_multiply(powers[k - 1], step);
+
+            for (size_t first{0}; first < length; first += 2 * span)
+                for (size_t k{0}; k < span; ++k)
+                {
+                    const uint32_t even{values[first + k]};
+                    const uint32_t odd{montgomery_multiply(
+                        values[first + k + span], powers[k])};
+                    values[first + k] =
+                        even + odd >= Prime ? even + odd - Prime : even + odd;
+                    values[first + k + span] =
+                        even >= odd ? even - odd : even + Prime - odd;
+                }
+        }
+    }
+
+    // Cyclic convolution of a and b modulo Prime, plain values, length a
+    // power of two
+    static std::vector<uint32_t> convolve(std::span<const int64_t> a,
+                                          std::span<const int64_t> b,
+                                          size_t length)
+    {
+        const auto load{[](int64_t value)
+                        { return to_montgomery(reduce(value)); }};
+        std::vector<uint32_t> fa(length), fb(length);
+        std::ranges::transform(a, fa.begin(), load);
+        std::ranges::transform(b, fb.begin(), load);
+        transform(fa, false);
+        transform(fb, false);
+        for (size_t i{0}; i < length; ++i)
+            fa[i] = montgomery_multiply(fa[i], fb[i]);
+        transform(fa, true);
+
+        // one multiplication divides by the length and leaves the form
+        const uint32_t scale{inverse(static_cast<uint32_t>(length % Prime))};
+        for (uint32_t& value : fa)
+            value = montgomery_multiply(value, scale);
+        return fa;
+    }
+};
+
+// 2^25 * 5 + 1, 2^26 * 7 + 1, 2^24 * 45 + 1
+using field1 = ntt_field<167'772'161, 3>;
+using field2 = ntt_field<469'762'049, 3>;
+using field3 = ntt_field<754'974'721, 11>;
+
+template <class Field>
+void convolve_into(std::span<const int64_t> a, std::span<const int64_t> b,
+                   size_t length, std::vector<uint32_t>& out)
+{
+    out = Field::convolve(a, b, length);
+}
+
+// Garner's mixed radix form x = x1 + p1 (x2 + p2 x3) of the number with
+// the given residues, read as signed around 0 and reduced modulo 2^64
+inline uint64_t combine_residues(uint32_t r1, uint32_t r2,
+                                 uint32_t r3) noexcept
+{
+    constexpr uint32_t p1{field1::PRIME}, p2{field2::PRIME}, p3{field3::PRIME};
+    constexpr uint32_t p1_inverse{field2::inverse(p1 % p2)};
+    constexpr uint32_t p1p2_inverse{
+        field3::inverse(field3::multiply(p1 % p3, p2 % p3))};
+
+    const uint32_t x1{r1};
+    const uint32_t x2{field2::multiply(
+        field2::reduce(int64_t{r2} - x1), p1_inverse)};
+    const uint32_t x3{field3::multiply(
+        field3::reduce(int64_t{r3} - x1 -
+                       static_cast<int64_t>(field3::multiply(x2, p1 % p3))),
+        p1p2_inverse)};
+
+    const uint64_t value{x1 + uint64_t{p1} * x2 + uint64_t{p1} * p2 * x3};
+    // every p - 1 is even, so (M - 1) / 2 has the digits (p - 1) / 2
+    const bool negative{
+        x3 != (p3 - 1) / 2 ? x3 > (p3 - 1) / 2
+        : x2 != (p2 - 1) / 2 ? x2 > (p2 - 1) / 2
+                             : x1 > (p1 - 1) / 2};
+    return negative ? value - uint64_t{p1} * p2 * p3 : value;
+}
+
+inline std::vector<int64_t> ntt(std::span<const int64_t> a,
+                                std::span<const int64_t> b, unsigned threads)
+{
+    const size_t size{a.size() + b.size() - 1};
+    size_t length{1};
+    while (length < size)
+        length *= 2;
+
+    std::array<std::vector<uint32_t>, 3> residues;
+    constexpr std::array tasks{&convolve_into<field1>, &convolve_into<field2>,
+                               &convolve_into<field3>};
+
+    const bool parallel{threads > 1 &&
+                        length >= polynom_multiply::PARALLEL_MIN};
+    if (parallel)
+    {
+        // one prime per thread, the calling one takes the last
+        std::vector<std::jthread> workers;
+        const size_t helpers{std::min<size_t>(threads, 3) - 1};
+        for (size_t i{0}; i < helpers; ++i)
+            workers.emplace_back(tasks[i], a, b, length,
+                                 std::ref(residues[i]));
+        for (size_t i{helpers}; i < 3; ++i)
+            tasks[i](a, b, length, residues[i]);
+    }
+    else
+        for (size_t i{0}; i < 3; ++i)
+            tasks[i](a, b, length, residues[i]);
+
+    std::vector<int64_t> result(size);
+    const auto combine{[&](size_t first, size_t last)
+                       {
+                           for (size_t i{first}; i < last; ++i)
+                               result[i] = static_cast<int64_t>(
+                                   combine_residues(residues[0][i],
+                                                    residues[1][i],
+                                                    residues[2][i]));
+                       }};
+
+    // every coefficient is independent, so all threads take a range
+    const size_t parts{parallel ? threads : 1};
+    {
+        std::vector<std::jthread> workers;
+        for (size_t part{1}; part < parts; ++part)
+            workers.emplace_back(combine, size * (part - 1) / parts,
+                                 size * part / parts);
+        combine(size * (parts - 1) / parts, size);
+    }
+    return result;
+}
+} // namespace polynom_detail
+
+namespace polynom_multiply
+{
+// Whether method can multiply lhs by rhs
+inline bool supports(method how, std::span<const int64_t> lhs,
+                     std::span<const int64_t> rhs) noexcept
+{
+    if (how != method::ntt)
+        return true;
+    return std::min(lhs.size(), rhs.size()) <= NTT_MAX_FACTOR &&
+           lhs.size() + rhs.size() <= NTT_MAX_LENGTH &&
+           polynom_detail::fits_int32(lhs) && polynom_detail::fits_int32(rhs);
+}
+
+// Schoolbook for short factors, the transform for long ones when their
+// coefficients allow, Karatsuba in between and for any 64 bit input
+inline method choose(std::span<const int64_t> lhs,
+                     std::span<const int64_t> rhs) noexcept
+{
+    const size_t shorter{std::min(lhs.size(), rhs.size())};
+    if (shorter < KARATSUBA_MIN)
+        return method::schoolbook;
+    if (shorter >= NTT_MIN && supports(method::ntt, lhs, rhs))
+        return method::ntt;
+    return method::karatsuba;
+}
+
+// lhs * rhs, lhs.size() + rhs.size() - 1 coefficients, none for an empty
+// factor. threads > 1 lets a long transform run its three primes
+// concurrently, which uses at most three threads, then split combining
+// the residues across all of them.
+inline std::vector<int64_t> multiply(std::span<const int64_t> lhs,
+                                     std::span<const int64_t> rhs, method how,
+                                     unsigned threads = 1)
+{
+    if (lhs.empty() || rhs.empty())
+        return {};
+    if (!supports(how, lhs, rhs))
+        throw std::invalid_argument{
+            "polynom_multiply: coefficients or length out of NTT range"};
+
+    if (how == method::ntt)
+        return polynom_detail::ntt(lhs, rhs, threads);
+
+    // two's complement products wrap the same in unsigned arithmetic
+    std::vector<uint64_t> a(lhs.begin(), lhs.end()), b(rhs.begin(), rhs.end());
+    if (a.size() < b.size())
+        a.swap(b);
+    std::vector<uint64_t> product(a.size() + b.size() - 1);
+    if (how == method::schoolbook)
+        polynom_detail::schoolbook(a.data(), a.size(), b.data(), b.size(),
+                                   product.data());
+    else
+        polynom_detail::karatsuba(a.data(), a.size(), b.data(), b.size(),
+                                  product.data());
+    return {product.begin(), product.end()};
+}
+
+inline std::vector<int64_t> multiply(std::span<const int64_t> lhs,
+                                     std::span<const int64_t> rhs,
+                                     unsigned threads = 1)
+{
+    return multiply(lhs, rhs, choose(lhs, rhs), threads);
+}
+} // namespace polynom_multiply
@@ -0,0 +1,286 @@
+#pragma once
+
+// Scoped latency probes. Build with ENABLE_PROBES (the EXPERIMENTS_PROBES
+// CMake option) to compile them in, otherwise PROBE_SCOPE expands to
+// nothing and probe::install() does nothing.
+//
+//     void hot_function()
+//     {
+//         PROBE_SCOPE("hot_function");
+//         ...
+//     }
+//
+// Every thread records into its own histograms with plain relaxed stores,
+// so recording never waits on other threads. probe::dump() adds up all
+// threads and prints one table; install() makes that happen at exit and
+// on SIGUSR1.
+
+#ifdef ENABLE_PROBES
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <charconv>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+
+#include <unistd.h>
+
+namespace probe
+{
+inline constexpr size_t MAX_SITES = 64;
+// bucket b counts durations in [2^(b-1), 2^b) ns
+inline constexpr size_t BUCKETS = 64;
+
+// Written by the owning thread only, read by dump() from any thread
+struct histogram
+{
+    std::array<std::atomic<uint64_t>, BUCKETS> buckets{};
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> total_ns{0};
+    std::atomic<uint64_t> max_ns{0};
+
+    void record(uint64_t ns) noexcept
+    {
+        const auto bump{[](std::atomic<uint64_t>& value, uint64_t delta)
+                        {
+                            value.store(
+                                value.load(std::memory_order_relaxed) + delta,
+                                std::memory_order_relaxed);
+                        }};
+
+        bump(buckets[std::min<size_t>(std::bit_width(ns), BUCKETS - 1)], 1);
+        bump(count, 1);
+        bump(total_ns, ns);
+        if (ns > max_ns.load(std::memory_order_relaxed))
+            max_ns.store(ns, std::memory_order_relaxed);
+    }
+};
+
+struct thread_block
+{
+    std::array<histogram, MAX_SITES> sites{};
+    thread_block* next{nullptr};
+};
+
+struct registry
+{
+    std::array<std::atomic<const char*>, MAX_SITES> names{};
+    std::atomic<size_t> site_count{0};
+    std::atomic<thread_block*> threads{nullptr};
+
+    static registry& instance() noexcept
+    {
+        static registry global;
+        return global;
+    }
+};
+
+// Blocks are never freed, so a dump after a thread exits still sees it
+inline thread_block* register_thread()
+{
+    auto* block{new thread_block};
+    auto& head{registry::instance().threads};
+    block->next = head.load();
+    while (!head.compare_exchange_weak(block->next, block))
+    {
+    }
+    return block;
+}
+
+inline thread_block& this_thread_block()
+{
+    thread_local thread_block* const block{register_thread()};
+    return *block;
+}
+
+// One per PROBE_SCOPE, created once as a function local static
+class site final
+{
+public:
+    explicit site(const char* name) noexcept
+        : m_index{registry::instance().site_count.fetch_add(1)}
+    {
+        if (m_index < MAX_SITES)
+            registry::instance().names[m_index].store(name);
+    }
+
+    size_t index() const noexcept { return m_index; }
+
+private:
+    size_t m_index;
+};
+
+class scoped final
+{
+    using clock = std::chrono::steady_clock;
+
+public:
+    explicit scoped(const site& where) noexcept
+        : m_index{where.index()}, m_start{clock::now()}
+    {
+    }
+
+    ~scoped()
+    {
+        if (m_index >= MAX_SITES)
+            return;
+        const auto ns{std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          clock::now() - m_start)
+                          .count()};
+        this_thread_block().sites[m_index].record(static_cast<uint64_t>(ns));
+    }
+
+private:
+    scoped(const scoped&) = delete;
+    scoped(scoped&&) noexcept = delete;
+    scoped& operator=(const scoped&) = delete;
+    scoped& operator=(scoped&&) noexcept = delete;
+
+    size_t m_index;
+    clock::time_point m_start;
+};
+
+// Line builder on a fixed buffer: no allocation and no locale, so dump()
+// can run inside a signal handler
+class line_writer final
+{
+public:
+    // left aligned in width
+    line_writer& text(std::string_view str, size_t width = 0) noexcept
+    {
+        const size_t length{std::min(str.size(), m_buffer.size() - m_size)};
+        std::memcpy(m_buffer.data() + m_size, str.data(), length);
+        m_size += length;
+        return spaces(width > length ? width - length : 0);
+    }
+
+    // right aligned in width
+    line_writer& number(uint64_t value, size_t width) noexcept
+    {
+        char digits[24];
+        const auto [end, ec]{std::to_chars(digits, digits + 24, value)};
+        const auto length{static_cast<size_t>(end - digits)};
+        spaces(width > length ? width - length : 0);
+        return text({digits, length});
+    }
+
+    void flush(int fd) noexcept
+    {
+        if (m_size < m_buffer.size())
+            m_buffer[m_size++] = '\n';
+        [[maybe_unused]] const auto written{
+            ::write(fd, m_buffer.data(), m_size)};
+        m_size = 0;
+    }
+
+private:
+    line_writer& spaces(size_t count) noexcept
+    {
+        for (; count > 0 && m_size < m_buffer.size(); --count)
+            m_buffer[m_size++] = ' ';
+        return *this;
+    }
+
+    std::array<char, 160> m_buffer{};
+    size_t m_size{0};
+};
+
+// upper bound of the bucket holding the given quantile
+inline uint64_t quantile_ns(const std::array<uint64_t, BUCKETS>& buckets,
+                            uint64_t count, double quantile) noexcept
+{
+    const auto target{static_cast<uint64_t>(quantile * count + 0.5)};
+    uint64_t seen{0};
+    for (size_t b{0}; b < BUCKETS; ++b)
+    {
+        seen += buckets[b];
+        if (seen >= target && seen > 0)
+            return b == 0 ? 0 : (uint64_t{1} << b) - 1;
+    }
+    return UINT64_MAX;
+}
+
+inline void dump(int fd = STDERR_FILENO) noexcept
+{
+    auto& global{registry::instance()};
+    const size_t sites{std::min(global.site_count.load(), MAX_SITES)};
+
+    line_writer line;
+    line.text("site", 32)
+        .text("      calls")
+        .text("   total us")
+        .text("    mean ns")
+        .text("  p50<= ns")
+        .text("  p99<= ns")
+        .text("    max ns")
+        .flush(fd);
+
+    for (size_t s{0}; s < sites; ++s)
+    {
+        std::array<uint64_t, BUCKETS> buckets{};
+        uint64_t count{0}, total{0}, max{0};
+        for (thread_block* block{global.threads.load()}; block != nullptr;
+             block = block->next)
+        {
+            const histogram& entry{block->sites[s]};
+            for (size_t b{0}; b < BUCKETS; ++b)
+                buckets[b] += entry.buckets[b].load(std::memory_order_relaxed);
+            count += entry.count.load(std::memory_order_relaxed);
+            total += entry.total_ns.load(std::memory_order_relaxed);
+            max = std::max(max, entry.max_ns.load(std::memory_order_relaxed));
+        }
+        if (count == 0)
+            continue;
+
+        const char* name{global.names[s].load()};
+        line.text(name != nullptr ? name : "?", 32)
+            .number(count, 11)
+            .number(total / 1000, 11)
+            .number(total / count, 11)
+            .number(quantile_ns(buckets, count, 0.5), 10)
+            .number(quantile_ns(buckets, count, 0.99), 10)
+            .number(max, 10)
+            .flush(fd);
+    }
+}
+
+// Dumps at normal exit and on every SIGUSR1
+inline void install() noexcept
+{
+    std::atexit([] { dump(); });
+    std::signal(SIGUSR1, [](int) { dump(); });
+}
+} // namespace probe
+
+#define PROBE_CONCAT_IMPL(a, b) a##b
+#define PROBE_CONCAT(a, b) PROBE_CONCAT_IMPL(a, b)
+#define PROBE_SCOPE(name)                                                      \
+    static const ::probe::site PROBE_CONCAT(probe_site_, __LINE__){name};      \
+    const ::probe::scoped PROBE_CONCAT(probe_scope_,                           \
+                                       __LINE__){PROBE_CONCAT(probe_site_,     \
+                                                              __LINE__)}
+// A named site at namespace scope, for scopes that must share one row of
+// the table, such as every instantiation of a function template
+#define PROBE_SITE(variable, name) inline const ::probe::site variable{name}
+#define PROBE_SCOPE_AT(variable)                                               \
+    const ::probe::scoped PROBE_CONCAT(probe_scope_, __LINE__){variable}
+
+#else
+
+namespace probe
+{
+inline void dump(int = 2) noexcept {}
+inline void install() noexcept {}
+} // namespace probe
+
+#define PROBE_SCOPE(name) static_cast<void>(0)
+#define PROBE_SITE(variable, name) static_assert(true)
+#define PROBE_SCOPE_AT(variable) static_cast<void>(0)
+
+#endif
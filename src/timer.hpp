@@ -0,0 +1,228 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <format>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define TIMER_HAS_RDTSC
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define TIMER_HAS_RDTSC
+#endif
+
+// Hides value from the optimizer so computing it can't be skipped
+template <typename T>
+inline void do_not_optimize(const T& value) noexcept
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static const void* volatile sink;
+    sink = &value;
+#endif
+}
+
+// Forces pending stores to be treated as observable
+inline void clobber_memory() noexcept
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : : "memory");
+#else
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+}
+
+struct benchmark_options
+{
+    std::chrono::nanoseconds warmup{std::chrono::milliseconds{50}};
+    // one sample runs at least this long
+    std::chrono::nanoseconds min_sample_time{std::chrono::microseconds{500}};
+    size_t max_iterations{size_t{1} << 30};
+    size_t samples{101};
+};
+
+// All times are nanoseconds per call, cycles are TSC ticks per call (NaN
+// without a time stamp counter)
+struct benchmark_result
+{
+    std::string name;
+    size_t iterations;
+    size_t samples;
+    double min;
+    double median;
+    double p99;
+    double mean;
+    double cycles;
+
+    std::string to_json() const
+    {
+        return std::format(
+            R"({{"name": "{}", "iterations": {}, "samples": {}, )"
+            R"("min_ns": {:.3f}, "median_ns": {:.3f}, "p99_ns": {:.3f}, )"
+            R"("mean_ns": {:.3f}, "cycles": {}}})",
+            name, iterations, samples, min, median, p99, mean,
+            std::isnan(cycles) ? std::string{"null"}
+                               : std::format("{:.2f}", cycles));
+    }
+
+    static std::string header()
+    {
+        return std::format("{:<24}{:>12}{:>12}{:>12}{:>12}{:>12}", "name",
+                           "min ns", "median ns", "p99 ns", "mean ns",
+                           "cycles");
+    }
+
+    std::string to_string() const
+    {
+        return std::format(
+            "{:<24}{:>12.2f}{:>12.2f}{:>12.2f}{:>12.2f}{:>12.1f}", name, min,
+            median, p99, mean, cycles);
+    }
+};
+
+class Timer final
+{
+    using clock = std::chrono::steady_clock;
+    using time_point = std::chrono::steady_clock::time_point;
+    using duration = std::chrono::duration<double>;
+
+public:
+    template <class Callable, typename... Args>
+    inline void operator()(Callable&& func_object, Args&&... args) const
+    {
+        time_point start{clock::now()};
+        func_object(std::forward<Args>(args)...);
+        duration time_passed{
+            std::chrono::duration_cast<duration>(clock::now() - start)};
+
+        std::clog << std::format("Time passed: {:.5}s\n", time_passed.count());
+    }
+
+    template <typename ReturnType, class Callable, typename... Args>
+    inline ReturnType operator()(Callable&& func_object, Args&&... args) const
+    {
+        time_point start{clock::now()};
+        ReturnType temp = func_object(std::forward<Args>(args)...);
+        duration time_passed{
+            std::chrono::duration_cast<duration>(clock::now() - start)};
+
+        std::clog << std::format("Time passed: {:.5}s\n", time_passed.count());
+
+        return temp;
+    }
+
+    // Silent variant, returns elapsed seconds
+    template <class Callable, typename... Args>
+    inline double seconds(Callable&& func_object, Args&&... args) const
+    {
+        time_point start{clock::now()};
+        func_object(std::forward<Args>(args)...);
+        return std::chrono::duration_cast<duration>(clock::now() - start)
+            .count();
+    }
+
+    // Statistical mode for sub-microsecond code: warms up, picks an
+    // iteration count so that one sample is far above the clock resolution,
+    // then reports per call statistics over all samples. Results of func
+    // are passed through do_not_optimize so the call can't be elided.
+    template <class Callable>
+    benchmark_result benchmark(std::string_view name, Callable&& func,
+                               const benchmark_options& options = {}) const
+    {
+        const auto run_batch{[&func](size_t iterations)
+                             {
+                                 for (size_t i{0}; i < iterations; ++i)
+                                 {
+                                     if constexpr (std::is_void_v<
+                                                       std::invoke_result_t<
+                                                           Callable&>>)
+                                         func();
+                                     else
+                                         do_not_optimize(func());
+                                     clobber_memory();
+                                 }
+                             }};
+
+        // warm up caches, branch predictors and the CPU frequency
+        const time_point warmup_end{clock::now() + options.warmup};
+        size_t iterations{1};
+        while (clock::now() < warmup_end)
+            run_batch(iterations);
+
+        // double the batch until one sample takes long enough
+        for (;;)
+        {
+            const time_point start{clock::now()};
+            run_batch(iterations);
+            if (clock::now() - start >= options.min_sample_time ||
+                iterations >= options.max_iterations)
+                break;
+            iterations *= 2;
+        }
+
+        std::vector<double> nanoseconds(options.samples);
+        std::vector<double> cycles(options.samples);
+        for (size_t i{0}; i < options.samples; ++i)
+        {
+            const uint64_t start_cycles{read_cycles()};
+            const time_point start{clock::now()};
+            run_batch(iterations);
+            const time_point stop{clock::now()};
+            const uint64_t stop_cycles{read_cycles()};
+
+            nanoseconds[i] =
+                std::chrono::duration<double, std::nano>(stop - start).count() /
+                iterations;
+            cycles[i] = static_cast<double>(stop_cycles - start_cycles) /
+                        iterations;
+        }
+
+        std::ranges::sort(nanoseconds);
+        std::ranges::sort(cycles);
+        const auto percentile{[](const std::vector<double>& sorted, double p)
+                              {
+                                  const auto index{static_cast<size_t>(
+                                      std::ceil(p * sorted.size()))};
+                                  return sorted[std::clamp(
+                                      index, size_t{1}, sorted.size()) - 1];
+                              }};
+
+        return {.name = std::string{name},
+                .iterations = iterations,
+                .samples = options.samples,
+                .min = nanoseconds.front(),
+                .median = percentile(nanoseconds, 0.5),
+                .p99 = percentile(nanoseconds, 0.99),
+                .mean = std::accumulate(nanoseconds.begin(),
+                                        nanoseconds.end(), 0.0) /
+                        nanoseconds.size(),
+                .cycles = HAS_CYCLE_COUNTER ? percentile(cycles, 0.5) : NAN};
+    }
+
+    // Time stamp counter, 0 where there is none
+    static inline uint64_t read_cycles() noexcept
+    {
+#ifdef TIMER_HAS_RDTSC
+        return __rdtsc();
+#else
+        return 0;
+#endif
+    }
+
+#ifdef TIMER_HAS_RDTSC
+    static constexpr bool HAS_CYCLE_COUNTER = true;
+#else
+    static constexpr bool HAS_CYCLE_COUNTER = false;
+#endif
+};
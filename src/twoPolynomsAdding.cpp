@@ -1,13 +1,38 @@
+#include "mapped_file.hpp"
+#include "polynom_multiply.hpp"
+#include "probe.hpp"
+#include "timer.hpp"
 #include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
 #include <format>
 #include <fstream>
 #include <functional>
 #include <iostream>
+#include <iterator>
 #include <list>
 #include <map>
 #include <ranges>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define POLYNOM_SSE2
+#endif
 
 namespace LexerParser
 {
@@ -23,8 +48,8 @@ enum class TokenType : unsigned char
 
 struct Token
 {
-    const int value;
-    const TokenType type;
+    int value;
+    TokenType type;
 
     explicit Token(const TokenType type, const int value = 0)
         : value(value), type(type)
@@ -36,131 +61,216 @@ struct Token
     bool operator!=(TokenType rhs) const { return type != rhs; }
     operator TokenType() const { return type; };
     operator int() const { return value; };
-
-private:
-    Token(const Token&) = delete;
-    Token(Token&&) noexcept = delete;
-    Token& operator=(const Token&) = delete;
-    Token&& operator=(Token&&) noexcept = delete;
 };
 
 // ------------------------------------------------------------------------
 
+// Scans a memory mapped file and hands out one token per next() call, so
+// no token is ever stored. Pages already scanned are released every
+// RELEASE_STEP bytes, which keeps memory use flat for any file size.
 class Lexer
 {
 private:
-    std::ifstream input_file;
-    std::string current_token_value;
-    std::list<Token> tokens;
-    size_t current_line;
-    TokenType current_token_type;
-    char current_char;
-
-    void skip_spaces();
-    void read_token();
-    void define_token_type();
-    void add_token();
-    void add_eof();
-    void reset_current_token();
+    static constexpr size_t RELEASE_STEP = size_t{16} << 20;
+
+    mapped_file input_file;
+    const char* position;
+    const char* input_end;
+    size_t released = 0;
+    size_t current_line = 1;
+    size_t token_count = 0;
+
+    static bool is_space(char ch) noexcept;
+    static bool is_digit(char ch) noexcept;
+    void skip_spaces() noexcept;
+    Token read_number();
+    Token read_eof();
+    void release_scanned() noexcept;
+
+    Lexer(const Lexer&) = delete;
+    Lexer(Lexer&&) noexcept = delete;
+    Lexer& operator=(const Lexer&) = delete;
+    Lexer& operator=(Lexer&&) noexcept = delete;
 
 public:
-    Lexer();
+    // Pulls tokens up to, not including, Eof
+    class iterator
+    {
+    private:
+        Lexer* lexer;
+        Token token;
+
+    public:
+        using value_type = Token;
+        using difference_type = std::ptrdiff_t;
+        using iterator_concept = std::input_iterator_tag;
+
+        explicit iterator(Lexer& lexer) : lexer(&lexer), token(lexer.next()) {}
+
+        const Token& operator*() const { return token; }
+        const Token* operator->() const { return &token; }
+
+        iterator& operator++()
+        {
+            token = lexer->next();
+            return *this;
+        }
+        void operator++(int) { ++*this; }
+
+        bool operator==(std::default_sentinel_t) const
+        {
+            return token == TokenType::Eof;
+        }
+    };
+
+    explicit Lexer(const std::string& path = "polynoms.txt");
     ~Lexer() = default;
 
-    inline void parse();
-    inline const std::list<Token>& get_tokens() const;
+    // Eof at the end of input and on every call after it
+    Token next();
+    size_t line() const noexcept { return current_line; }
+    // bytes of the whole input
+    size_t input_size() const noexcept { return input_file.size(); }
+
+    iterator begin() { return iterator(*this); }
+    std::default_sentinel_t end() const noexcept { return {}; }
 };
 
-Lexer::Lexer()
-    : current_token_value(""), current_line(1),
-      current_token_type(TokenType::Undefined), current_char('\0')
+Lexer::Lexer(const std::string& path)
+    : input_file(path), position(input_file.data()),
+      input_end(input_file.data() + input_file.size())
 {
-    input_file.open("polynoms.txt", std::ios::in);
-    if (!input_file.is_open())
-        throw std::runtime_error("[FATAL] Can't open input file!");
+}
 
-    current_char = input_file.get();
+bool Lexer::is_space(char ch) noexcept
+{
+    return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\v' || ch == '\f';
 }
 
-void Lexer::skip_spaces()
+bool Lexer::is_digit(char ch) noexcept { return ch >= '0' && ch <= '9'; }
+
+void Lexer::skip_spaces() noexcept
 {
-    while (isspace(current_char) && current_char != '\n')
-        current_char = input_file.get();
+    while (position != input_end && is_space(*position))
+        ++position;
 }
 
-void Lexer::read_token()
+Token Lexer::next()
 {
+    PROBE_SCOPE("Lexer::next");
     skip_spaces();
-    if (input_file.eof())
-    {
-        add_eof();
-        return;
-    }
-    if (current_char == '\n')
+    if (position == input_end)
+        return read_eof();
+
+    ++token_count;
+    if (*position == '\n')
     {
-        current_token_value += current_char;
+        ++position;
         ++current_line;
+        release_scanned();
+        return Token(TokenType::Newline, '\n');
     }
-    else
-    {
-        while (!isspace(current_char) && !input_file.eof())
-        {
-            current_token_value += current_char;
-            current_char = input_file.get();
-        }
-    }
-    add_token();
+    return read_number();
 }
 
-void Lexer::define_token_type()
+Token Lexer::read_number()
 {
-    if (current_token_value == "\n")
-        current_token_type = TokenType::Newline;
-    else if (std::ranges::all_of(current_token_value, ::isdigit))
-        current_token_type = TokenType::Number;
-    else
+    const char* first{position};
+    // stops growing once out of range, so it never wraps
+    uint64_t value{0};
+    for (; position != input_end && is_digit(*position); ++position)
+        if (value <= INT_MAX)
+            value = value * 10 + static_cast<uint64_t>(*position - '0');
+
+    const auto token_end{[this]
+                         {
+                             return position == input_end ||
+                                    *position == '\n' || is_space(*position);
+                         }};
+    if (position == first || !token_end())
+    {
+        while (!token_end())
+            ++position;
         throw std::runtime_error(
             std::format("[FATAL] Invalid token \"{}\" at line: {}",
-                        current_token_value, std::to_string(current_line)));
+                        std::string_view(first, position), current_line));
+    }
+    if (value > INT_MAX)
+        throw std::runtime_error(
+            std::format("[FATAL] Number \"{}\" out of range at line: {}",
+                        std::string_view(first, position), current_line));
+
+    return Token(TokenType::Number, static_cast<int>(value));
 }
 
-void Lexer::add_token()
+Token Lexer::read_eof()
 {
-    define_token_type();
-
-    if (current_token_type == TokenType::Number)
-        tokens.emplace_back(current_token_type, std::stoi(current_token_value));
-    else if (current_token_type == TokenType::Newline)
-        tokens.emplace_back(current_token_type, '\n');
-
-    reset_current_token();
+    // counted once, later calls just repeat Eof
+    if (token_count++ < 6)
+        throw std::runtime_error("[FATAL] Invalid input (too few numbers)!");
+    return Token(TokenType::Eof);
 }
 
-void Lexer::add_eof()
+void Lexer::release_scanned() noexcept
 {
-    current_token_type = TokenType::Eof;
-    tokens.emplace_back(current_token_type);
+    const auto scanned{static_cast<size_t>(position - input_file.data())};
+    if (scanned - released >= RELEASE_STEP)
+    {
+        input_file.release(scanned);
+        released = scanned;
+    }
 }
 
-void Lexer::reset_current_token()
+// ------------------------------------------------------------------------
+
+// The whole token stream, kept only for error reporting or replay. Values
+// and types live in separate arrays, five bytes per token.
+class TokenBuffer
 {
-    if (current_token_type == TokenType::Newline)
-        current_char = input_file.get();
+private:
+    std::vector<int> values;
+    std::vector<TokenType> types;
 
-    current_token_type = TokenType::Undefined;
-    current_token_value.clear();
-}
+public:
+    TokenBuffer() = default;
+    ~TokenBuffer() = default;
+
+    // Reads lexer to the end, Eof included
+    explicit TokenBuffer(Lexer& lexer);
+
+    void reserve(size_t count);
+    void push_back(const Token& token);
+
+    size_t size() const noexcept { return types.size(); }
+    int value(size_t index) const noexcept { return values[index]; }
+    TokenType type(size_t index) const noexcept { return types[index]; }
+    Token operator[](size_t index) const
+    {
+        return Token(types[index], values[index]);
+    }
+};
 
-inline void Lexer::parse()
+TokenBuffer::TokenBuffer(Lexer& lexer)
 {
-    while (current_token_type != TokenType::Eof)
-        read_token();
+    // An estimate: a typical line such as "123 456\n" is 3 tokens in 8
+    // bytes. Denser input just makes push_back grow the buffer.
+    reserve(lexer.input_size() / 3 + 1);
+    for (const Token& token : lexer)
+        push_back(token);
+    push_back(Token(TokenType::Eof));
+}
 
-    if (tokens.size() < 7)
-        throw std::runtime_error("[FATAL] Invalid input (too few numbers)!");
+void TokenBuffer::reserve(size_t count)
+{
+    values.reserve(count);
+    types.reserve(count);
 }
 
-inline const std::list<Token>& Lexer::get_tokens() const { return tokens; }
+void TokenBuffer::push_back(const Token& token)
+{
+    values.push_back(token.value);
+    types.push_back(token.type);
+}
 
 // ------------------------------------------------------------------------
 
@@ -175,24 +285,43 @@ private:
     polynom_t* current_polynom = &polynom1;
     size_t current_line = 1;
     bool line_added = false;
+    // of both polynomials, for is_dense()
+    size_t term_count = 0;
+    int highest_power = -1;
 
     void reset();
     void switch_polynoms() noexcept;
     void add_values(const Token& power, const Token& base);
+    void accept(const Token& current_token, const Token& next_token);
 
 public:
-    Parser() = default;
+    explicit Parser(const std::string& path = "polynoms.txt") : lexer(path) {}
     ~Parser() = default;
 
+    // Pulls the tokens from the lexer
     void parse();
+    // Walks a stored token stream by index instead of the lexer
+    void parse(const TokenBuffer& tokens);
+    // Any other sequence of tokens ending in Eof
+    template <std::ranges::forward_range Tokens>
+    void parse(const Tokens& tokens);
     polynom_t& get_polynom1() { return polynom1; }
     polynom_t& get_polynom2() { return polynom2; }
+
+    // Whether the parsed powers fill at least 1 / DENSE_FILL of the range
+    // up to the highest one, so that a coefficient array beats a list of
+    // terms
+    bool is_dense() const noexcept;
+    // merging a term costs about four times adding a dense coefficient
+    static constexpr size_t DENSE_FILL = 4;
 };
 
 void Parser::reset()
 {
     polynom1.clear();
     polynom2.clear();
+    term_count = 0;
+    highest_power = -1;
 }
 
 void Parser::switch_polynoms() noexcept
@@ -203,43 +332,415 @@ void Parser::switch_polynoms() noexcept
 
 void Parser::add_values(const Token& power, const Token& base)
 {
-    current_polynom->emplace(power, base);
+    if (current_polynom->emplace(power, base).second)
+    {
+        ++term_count;
+        highest_power = std::max(highest_power, power.value);
+    }
     line_added = true;
 }
 
+bool Parser::is_dense() const noexcept
+{
+    // highest_power may be INT_MAX, so widen before adding 1
+    const auto powers{static_cast<size_t>(int64_t{highest_power} + 1)};
+    return powers <= term_count * DENSE_FILL;
+}
+
+// Looks at one pair of neighbouring tokens
+void Parser::accept(const Token& current_token, const Token& next_token)
+{
+    if (current_token == TokenType::Number && next_token == TokenType::Number)
+    {
+        if (!line_added)
+            add_values(current_token, next_token);
+        else
+            throw std::runtime_error(
+                std::format("[FATAL] Unexpected token: \"{}\" at line: {}",
+                            next_token.value, current_line));
+    }
+    else if (current_token == TokenType::Newline &&
+             next_token == TokenType::Newline)
+    {
+        switch_polynoms();
+        line_added = false;
+    }
+    else if (current_token == TokenType::Newline)
+    {
+        ++current_line;
+        line_added = false;
+    }
+}
+
 void Parser::parse()
 {
-    lexer.parse();
+    PROBE_SCOPE("Parser::parse(lexer)");
+    Token current_token{lexer.next()};
+    if (current_token == TokenType::Eof)
+        return;
+
+    for (Token next_token{lexer.next()}; next_token != TokenType::Eof;
+         current_token = next_token, next_token = lexer.next())
+        accept(current_token, next_token);
+}
+
+void Parser::parse(const TokenBuffer& tokens)
+{
+    PROBE_SCOPE("Parser::parse(buffer)");
+    for (size_t i{1}; i < tokens.size() && tokens.type(i) != TokenType::Eof;
+         ++i)
+        accept(tokens[i - 1], tokens[i]);
+}
 
-    auto current_token{lexer.get_tokens().begin()};
-    auto next_token{current_token};
-    ++next_token;
+// one row for all instantiations
+PROBE_SITE(parse_range_site, "Parser::parse(range)");
 
-    for (; (*next_token) != LexerParser::TokenType::Eof;
+template <std::ranges::forward_range Tokens>
+void Parser::parse(const Tokens& tokens)
+{
+    PROBE_SCOPE_AT(parse_range_site);
+    auto current_token{std::ranges::begin(tokens)};
+    if (current_token == std::ranges::end(tokens))
+        return;
+
+    for (auto next_token{std::next(current_token)};
+         next_token != std::ranges::end(tokens) &&
+         *next_token != TokenType::Eof;
          ++current_token, ++next_token)
+        accept(*current_token, *next_token);
+}
+
+// -----------------------------------------------------------------------
+
+// Coefficients in one array indexed by power, for polynomials where most
+// powers up to the highest one are present. Addition, subtraction and
+// scaling run over the arrays four coefficients at a time with SSE2.
+class DensePolynom
+{
+public:
+    using polynom_t = std::map<int, int>;
+
+private:
+    std::vector<int> coefficients;
+
+    // out[i] = op(left[i], right[i]) for i in [first, last), a null side
+    // reads as zeros
+    template <class Binary_Operator>
+    static void apply(Binary_Operator& op, const int* left, const int* right,
+                      int* out, size_t first, size_t last) noexcept;
+
+public:
+    DensePolynom() = default;
+    // size zero coefficients, powers 0 to size - 1
+    explicit DensePolynom(size_t size) : coefficients(size) {}
+    explicit DensePolynom(const polynom_t& polynom);
+    ~DensePolynom() = default;
+
+    // highest power + 1, trailing zeros included
+    size_t size() const noexcept { return coefficients.size(); }
+    // 0 for powers past the end
+    int operator[](size_t power) const noexcept
+    {
+        return power < coefficients.size() ? coefficients[power] : 0;
+    }
+    const int* data() const noexcept { return coefficients.data(); }
+
+    // Every power up to the highest, as PolynomProcessor::combine_maps()
+    // returns them
+    polynom_t to_map() const;
+
+    // Calls func(power, coefficient) for every power, zeros included
+    template <class Callable>
+    void for_each(Callable&& func) const;
+
+    // op(lhs[i], rhs[i]) for every power of the longer one
+    template <class Binary_Operator>
+    static DensePolynom combine(const DensePolynom& lhs,
+                                const DensePolynom& rhs, Binary_Operator&& op);
+
+    friend DensePolynom operator+(const DensePolynom& lhs,
+                                  const DensePolynom& rhs)
+    {
+        return combine(lhs, rhs, std::plus<int>());
+    }
+    friend DensePolynom operator-(const DensePolynom& lhs,
+                                  const DensePolynom& rhs)
+    {
+        return combine(lhs, rhs, std::minus<int>());
+    }
+    friend DensePolynom operator*(const DensePolynom& polynom, int factor);
+};
+
+DensePolynom::DensePolynom(const polynom_t& polynom)
+{
+    // the lexer reads no signs, so every power is at least 0
+    if (polynom.empty())
+        return;
+    coefficients.resize(static_cast<size_t>(polynom.crbegin()->first) + 1);
+    for (const auto& [power, base] : polynom)
+        coefficients[static_cast<size_t>(power)] = base;
+}
+
+DensePolynom::polynom_t DensePolynom::to_map() const
+{
+    polynom_t result;
+    for (size_t power{0}; power < coefficients.size(); ++power)
+        result.emplace_hint(result.end(), static_cast<int>(power),
+                            coefficients[power]);
+    return result;
+}
+
+template <class Callable>
+void DensePolynom::for_each(Callable&& func) const
+{
+    for (size_t power{0}; power < coefficients.size(); ++power)
+        func(power, coefficients[power]);
+}
+
+template <class Binary_Operator>
+DensePolynom DensePolynom::combine(const DensePolynom& lhs,
+                                   const DensePolynom& rhs,
+                                   Binary_Operator&& op)
+{
+    DensePolynom result(std::max(lhs.size(), rhs.size()));
+    const size_t common{std::min(lhs.size(), rhs.size())};
+    int* out{result.coefficients.data()};
+
+    apply(op, lhs.data(), rhs.data(), out, 0, common);
+    apply(op, lhs.data(), nullptr, out, common, lhs.size());
+    apply(op, nullptr, rhs.data(), out, common, rhs.size());
+    return result;
+}
+
+template <class Binary_Operator>
+void DensePolynom::apply(Binary_Operator& op, const int* left,
+                         const int* right, int* out, size_t first,
+                         size_t last) noexcept
+{
+    using op_t = std::remove_cvref_t<Binary_Operator>;
+    constexpr bool adds{std::is_same_v<op_t, std::plus<int>> ||
+                        std::is_same_v<op_t, std::plus<>>};
+    constexpr bool subtracts{std::is_same_v<op_t, std::minus<int>> ||
+                             std::is_same_v<op_t, std::minus<>>};
+
+    size_t i{first};
+#ifdef POLYNOM_SSE2
+    if constexpr (adds || subtracts)
     {
-        if (*current_token == TokenType::Number &&
-            *next_token == TokenType::Number)
+        const auto load{[](const int* from)
+                        {
+                            return from == nullptr
+                                       ? _mm_setzero_si128()
+                                       : _mm_loadu_si128(
+                                             reinterpret_cast<const __m128i*>(
+                                                 from));
+                        }};
+        for (; i + 4 <= last; i += 4)
         {
-            if (!line_added)
-                add_values(*current_token, *next_token);
-            else
-                throw std::runtime_error(
-                    std::format("[FATAL] Unexpected token: \"{}\" at line: {}",
-                                next_token->value, current_line));
+            const __m128i a{load(left == nullptr ? nullptr : left + i)};
+            const __m128i b{load(right == nullptr ? nullptr : right + i)};
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),
+                             adds ? _mm_add_epi32(a, b) : _mm_sub_epi32(a, b));
         }
-        else if (*current_token == TokenType::Newline &&
-                 *next_token == TokenType::Newline)
+    }
+#endif
+    for (; i < last; ++i)
+        out[i] = op(left == nullptr ? 0 : left[i],
+                    right == nullptr ? 0 : right[i]);
+}
+
+DensePolynom operator*(const DensePolynom& polynom, int factor)
+{
+    DensePolynom result(polynom.size());
+    const int* in{polynom.data()};
+    int* out{result.coefficients.data()};
+
+    size_t i{0};
+#ifdef POLYNOM_SSE2
+    // SSE2 only multiplies the even lanes into 64 bits, the low halves of
+    // both products are the 32 bit results
+    const __m128i even_factor{_mm_set1_epi32(factor)};
+    const __m128i odd_factor{_mm_srli_si128(even_factor, 4)};
+    for (; i + 4 <= polynom.size(); i += 4)
+    {
+        const __m128i values{
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i))};
+        const __m128i even{_mm_mul_epu32(values, even_factor)};
+        const __m128i odd{
+            _mm_mul_epu32(_mm_srli_si128(values, 4), odd_factor)};
+        _mm_storeu_si128(
+            reinterpret_cast<__m128i*>(out + i),
+            _mm_unpacklo_epi32(
+                _mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0))));
+    }
+#endif
+    for (; i < polynom.size(); ++i)
+        out[i] = in[i] * factor;
+    return result;
+}
+
+// -----------------------------------------------------------------------
+
+// Only the present terms, sorted by power, for polynomials whose powers
+// are few and far apart. Addition and subtraction merge the two term
+// lists in one pass, so a result has at most the terms of both inputs
+// whatever the highest power is.
+class SparsePolynom
+{
+public:
+    using polynom_t = std::map<int, int>;
+    // power, coefficient
+    using term_t = std::pair<int, int>;
+
+private:
+    std::vector<term_t> terms;
+
+public:
+    SparsePolynom() = default;
+    explicit SparsePolynom(const polynom_t& polynom)
+        : terms(polynom.begin(), polynom.end())
+    {
+    }
+    ~SparsePolynom() = default;
+
+    // number of terms
+    size_t size() const noexcept { return terms.size(); }
+    // 0 for absent powers, a binary search
+    int operator[](size_t power) const noexcept;
+    const term_t* data() const noexcept { return terms.data(); }
+
+    // Calls func(power, coefficient) for every term, powers ascending
+    template <class Callable>
+    void for_each(Callable&& func) const;
+
+    // op(lhs[power], rhs[power]) for every power that either one has
+    template <class Binary_Operator>
+    static SparsePolynom combine(const SparsePolynom& lhs,
+                                 const SparsePolynom& rhs,
+                                 Binary_Operator&& op);
+
+    friend SparsePolynom operator+(const SparsePolynom& lhs,
+                                   const SparsePolynom& rhs)
+    {
+        return combine(lhs, rhs, std::plus<int>());
+    }
+    friend SparsePolynom operator-(const SparsePolynom& lhs,
+                                   const SparsePolynom& rhs)
+    {
+        return combine(lhs, rhs, std::minus<int>());
+    }
+};
+
+int SparsePolynom::operator[](size_t power) const noexcept
+{
+    const auto term{std::ranges::lower_bound(
+        terms, power, {}, [](const term_t& term)
+        { return static_cast<size_t>(term.first); })};
+    return term != terms.end() && static_cast<size_t>(term->first) == power
+               ? term->second
+               : 0;
+}
+
+template <class Callable>
+void SparsePolynom::for_each(Callable&& func) const
+{
+    for (const auto& [power, coefficient] : terms)
+        func(static_cast<size_t>(power), coefficient);
+}
+
+template <class Binary_Operator>
+SparsePolynom SparsePolynom::combine(const SparsePolynom& lhs,
+                                     const SparsePolynom& rhs,
+                                     Binary_Operator&& op)
+{
+    SparsePolynom result;
+    result.terms.reserve(lhs.size() + rhs.size());
+
+    auto left{lhs.terms.begin()};
+    auto right{rhs.terms.begin()};
+    while (left != lhs.terms.end() && right != rhs.terms.end())
+    {
+        if (left->first < right->first)
+        {
+            result.terms.emplace_back(left->first, op(left->second, 0));
+            ++left;
+        }
+        else if (right->first < left->first)
         {
-            switch_polynoms();
-            line_added = false;
+            result.terms.emplace_back(right->first, op(0, right->second));
+            ++right;
         }
-        else if (*current_token == TokenType::Newline)
+        else
         {
-            ++current_line;
-            line_added = false;
+            result.terms.emplace_back(left->first,
+                                      op(left->second, right->second));
+            ++left;
+            ++right;
         }
     }
+    for (; left != lhs.terms.end(); ++left)
+        result.terms.emplace_back(left->first, op(left->second, 0));
+    for (; right != rhs.terms.end(); ++right)
+        result.terms.emplace_back(right->first, op(0, right->second));
+    return result;
+}
+
+// Result of PolynomProcessor, in the form Parser::is_dense() picked
+using Polynom = std::variant<DensePolynom, SparsePolynom>;
+
+// -----------------------------------------------------------------------
+
+// Result of PolynomProcessor::multiply(), with 64 bit powers and
+// coefficients which wrap modulo 2^64 on overflow. Either a coefficient
+// array indexed by power or the present terms sorted by power.
+class Product
+{
+public:
+    // power, coefficient
+    using term_t = std::pair<int64_t, int64_t>;
+
+private:
+    // empty when terms holds the result
+    std::vector<int64_t> coefficients;
+    std::vector<term_t> terms;
+
+public:
+    Product() = default;
+    explicit Product(std::vector<int64_t> coefficients)
+        : coefficients(std::move(coefficients))
+    {
+    }
+    explicit Product(std::vector<term_t> terms) : terms(std::move(terms)) {}
+    ~Product() = default;
+
+    // 0 for absent powers
+    int64_t operator[](int64_t power) const noexcept;
+
+    // Calls func(power, coefficient) for every stored power, ascending
+    template <class Callable>
+    void for_each(Callable&& func) const;
+};
+
+int64_t Product::operator[](int64_t power) const noexcept
+{
+    if (terms.empty())
+        return power >= 0 && static_cast<size_t>(power) < coefficients.size()
+                   ? coefficients[static_cast<size_t>(power)]
+                   : 0;
+
+    const auto term{std::ranges::lower_bound(terms, power, {},
+                                             &term_t::first)};
+    return term != terms.end() && term->first == power ? term->second : 0;
+}
+
+template <class Callable>
+void Product::for_each(Callable&& func) const
+{
+    for (size_t power{0}; power < coefficients.size(); ++power)
+        func(static_cast<int64_t>(power), coefficients[power]);
+    for (const auto& [power, coefficient] : terms)
+        func(power, coefficient);
 }
 
 // -----------------------------------------------------------------------
@@ -259,47 +760,524 @@ private:
     PolynomProcessor& operator=(const PolynomProcessor&) = delete;
     PolynomProcessor&& operator=(PolynomProcessor&&) noexcept = delete;
 
-    size_t find_max_key();
-
 public:
     PolynomProcessor();
     ~PolynomProcessor() = default;
 
+    // dense() or sparse(), as the parser finds the input
+    template <class Binary_Operator>
+    Polynom operator()(Binary_Operator&& op);
+
+    // Same coefficients as combine_maps() on copies of the parsed maps,
+    // which are only read
+    template <class Binary_Operator>
+    DensePolynom dense(Binary_Operator&& op);
+    // Same coefficients as combine_maps() at the powers either input has,
+    // no others are stored
+    template <class Binary_Operator>
+    SparsePolynom sparse(Binary_Operator&& op);
+
+    // Product of the parsed polynomials. Dense when the parser finds the
+    // input dense or the product's power range is no longer than the list
+    // of term pairs a sparse product has to sort, sparse otherwise.
+    Product multiply(unsigned threads = std::thread::hardware_concurrency());
+
+    // op(polynom1[i], polynom2[i]) for every power from 0 to the highest.
+    // Inserts the missing powers into both inputs as zeros.
     template <class Binary_Operator>
-    polynom_t operator()(Binary_Operator&& op);
+    static polynom_t combine_maps(polynom_t& polynom1, polynom_t& polynom2,
+                                  Binary_Operator&& op);
+
+    // Through polynom_multiply::multiply(), which picks the algorithm
+    static Product multiply_dense(const polynom_t& polynom1,
+                                  const polynom_t& polynom2,
+                                  unsigned threads = 1);
+    // Every pair of terms, sorted and summed by power
+    static Product multiply_sparse(const polynom_t& polynom1,
+                                   const polynom_t& polynom2);
 };
 
 PolynomProcessor::PolynomProcessor()
     : polynom1(parser.get_polynom1()), polynom2(parser.get_polynom2()){};
 
-size_t PolynomProcessor::find_max_key()
+template <class Binary_Operator>
+Polynom PolynomProcessor::operator()(Binary_Operator&& op)
 {
-    return std::max((polynom1.crbegin())->first, (polynom2.crbegin())->first);
+    parser.parse();
+    if (parser.is_dense())
+        return DensePolynom::combine(DensePolynom(polynom1),
+                                     DensePolynom(polynom2), op);
+    return SparsePolynom::combine(SparsePolynom(polynom1),
+                                  SparsePolynom(polynom2), op);
 }
 
 template <class Binary_Operator>
-PolynomProcessor::polynom_t PolynomProcessor::operator()(Binary_Operator&& op)
+DensePolynom PolynomProcessor::dense(Binary_Operator&& op)
+{
+    parser.parse();
+    return DensePolynom::combine(DensePolynom(polynom1),
+                                 DensePolynom(polynom2), op);
+}
+
+template <class Binary_Operator>
+SparsePolynom PolynomProcessor::sparse(Binary_Operator&& op)
+{
+    parser.parse();
+    return SparsePolynom::combine(SparsePolynom(polynom1),
+                                  SparsePolynom(polynom2), op);
+}
+
+Product PolynomProcessor::multiply(unsigned threads)
 {
-    polynom_t result;
     parser.parse();
+    if (polynom1.empty() || polynom2.empty())
+        return Product();
+
+    const int64_t range{int64_t{polynom1.crbegin()->first} +
+                        polynom2.crbegin()->first + 1};
+    const auto pairs{static_cast<int64_t>(polynom1.size() * polynom2.size())};
+    if (parser.is_dense() || range <= pairs)
+        return multiply_dense(polynom1, polynom2, std::max(threads, 1u));
+    return multiply_sparse(polynom1, polynom2);
+}
 
-    std::ranges::for_each(std::views::iota(0ul, find_max_key() + 1),
-                          [&, this](auto i)
-                          { result[i] = op(polynom1[i], polynom2[i]); });
+Product PolynomProcessor::multiply_dense(const polynom_t& polynom1,
+                                         const polynom_t& polynom2,
+                                         unsigned threads)
+{
+    if (polynom1.empty() || polynom2.empty())
+        return Product();
+
+    const auto coefficients{[](const polynom_t& polynom)
+                            {
+                                std::vector<int64_t> result(
+                                    static_cast<size_t>(
+                                        polynom.crbegin()->first) +
+                                    1);
+                                for (const auto& [power, base] : polynom)
+                                    result[static_cast<size_t>(power)] = base;
+                                return result;
+                            }};
+    return Product(polynom_multiply::multiply(
+        coefficients(polynom1), coefficients(polynom2), threads));
+}
+
+Product PolynomProcessor::multiply_sparse(const polynom_t& polynom1,
+                                          const polynom_t& polynom2)
+{
+    std::vector<Product::term_t> pairs;
+    pairs.reserve(polynom1.size() * polynom2.size());
+    for (const auto& [power1, base1] : polynom1)
+        for (const auto& [power2, base2] : polynom2)
+            pairs.emplace_back(int64_t{power1} + power2,
+                               int64_t{base1} * base2);
+    std::ranges::sort(pairs, {}, &Product::term_t::first);
+
+    // equal powers are neighbours now; sums wrap like the dense product
+    std::vector<Product::term_t> terms;
+    for (const auto& [power, coefficient] : pairs)
+        if (!terms.empty() && terms.back().first == power)
+            terms.back().second = static_cast<int64_t>(
+                static_cast<uint64_t>(terms.back().second) +
+                static_cast<uint64_t>(coefficient));
+        else
+            terms.emplace_back(power, coefficient);
+    return Product(std::move(terms));
+}
+
+template <class Binary_Operator>
+PolynomProcessor::polynom_t
+PolynomProcessor::combine_maps(polynom_t& polynom1, polynom_t& polynom2,
+                               Binary_Operator&& op)
+{
+    polynom_t result;
+    if (polynom1.empty() && polynom2.empty())
+        return result;
+
+    const int max_key{std::max(polynom1.empty() ? 0 : polynom1.crbegin()->first,
+                               polynom2.empty() ? 0
+                                                : polynom2.crbegin()->first)};
+    std::ranges::for_each(std::views::iota(int64_t{0}, int64_t{max_key} + 1),
+                          [&](int64_t power)
+                          {
+                              const auto i{static_cast<int>(power)};
+                              result[i] = op(polynom1[i], polynom2[i]);
+                          });
     return result;
 }
 }; // namespace LexerParser
 
-int main()
+// Two polynomials with pseudo random coefficients, the first of size
+// terms stride powers apart, the second half as long with every other
+// term moved between those of the first
+inline std::pair<std::map<int, int>, std::map<int, int>>
+make_polynoms(size_t size, size_t stride = 1)
+{
+    std::pair<std::map<int, int>, std::map<int, int>> polynoms;
+    uint32_t seed{12345};
+    for (size_t term{0}; term < size; ++term)
+    {
+        seed = seed * 1'103'515'245 + 12'345;
+        const auto power{static_cast<int>(term * stride)};
+        polynoms.first.emplace(power, seed >> 20);
+        if (term < size / 2)
+            polynoms.second.emplace(
+                power + static_cast<int>(term % 2 * (stride / 2)),
+                seed >> 22);
+    }
+    return polynoms;
+}
+
+// Time of one addition, subtraction and scaling of polynomials with
+// many powers in both representations. Returns whether they agree.
+inline bool arithmetic_benchmark()
+{
+    using LexerParser::DensePolynom;
+    using LexerParser::PolynomProcessor;
+    using LexerParser::SparsePolynom;
+
+    Timer measure;
+    benchmark_options options;
+    options.samples = 21;
+    std::vector<benchmark_result> results;
+    bool same{true};
+
+    for (const size_t size :
+         {size_t{1'000}, size_t{100'000}, size_t{1'000'000}})
+    {
+        auto [map1, map2] = make_polynoms(size);
+        // the first call inserts the missing powers, later ones don't
+        const auto map_sum{PolynomProcessor::combine_maps(map1, map2,
+                                                          std::plus<int>())};
+        const auto map_difference{PolynomProcessor::combine_maps(
+            map1, map2, std::minus<int>())};
+        const DensePolynom dense1(map1);
+        const DensePolynom dense2(map2);
+
+        same = same && (dense1 + dense2).to_map() == map_sum &&
+               (dense1 - dense2).to_map() == map_difference;
+        const DensePolynom scaled{dense1 * -7};
+        for (size_t power{0}; power < size; ++power)
+            same = same && scaled[power] == map1[static_cast<int>(power)] * -7;
+
+        results.push_back(measure.benchmark(
+            std::format("map add {}", size),
+            [&]
+            {
+                return PolynomProcessor::combine_maps(map1, map2,
+                                                      std::plus<int>())
+                    .size();
+            },
+            options));
+        results.push_back(measure.benchmark(
+            std::format("dense add {}", size),
+            [&] { return (dense1 + dense2).size(); }, options));
+        results.push_back(measure.benchmark(
+            std::format("dense sub {}", size),
+            [&] { return (dense1 - dense2).size(); }, options));
+        results.push_back(measure.benchmark(
+            std::format("dense scale {}", size),
+            [&] { return (dense1 * 3).size(); }, options));
+    }
+
+    // Sparse against map at a few strides, then against dense around
+    // Parser::DENSE_FILL, and a degree no other form could afford
+    for (const size_t stride : {size_t{2}, size_t{8}, size_t{32}})
+    {
+        auto [map1, map2] = make_polynoms(100'000 / stride, stride);
+        // before combine_maps() fills in the missing powers
+        const SparsePolynom sparse1(map1);
+        const SparsePolynom sparse2(map2);
+        const auto map_sum{PolynomProcessor::combine_maps(map1, map2,
+                                                          std::plus<int>())};
+        const auto map_difference{PolynomProcessor::combine_maps(
+            map1, map2, std::minus<int>())};
+        const SparsePolynom sum{sparse1 + sparse2};
+        const SparsePolynom difference{sparse1 - sparse2};
+        for (const auto& [power, base] : map_sum)
+            same = same && sum[static_cast<size_t>(power)] == base &&
+                   difference[static_cast<size_t>(power)] ==
+                       map_difference.at(power);
+
+        const DensePolynom dense1(map1);
+        const DensePolynom dense2(map2);
+        results.push_back(measure.benchmark(
+            std::format("dense add 1/{}", stride),
+            [&] { return (dense1 + dense2).size(); }, options));
+        results.push_back(measure.benchmark(
+            std::format("sparse add 1/{}", stride),
+            [&] { return (sparse1 + sparse2).size(); }, options));
+    }
+
+    const auto [map1, map2] = make_polynoms(100'000, 20'000);
+    const SparsePolynom sparse1(map1);
+    const SparsePolynom sparse2(map2);
+    results.push_back(measure.benchmark(
+        "sparse add 1e5 terms", [&] { return (sparse1 + sparse2).size(); },
+        options));
+
+    std::cout << benchmark_result::header() << '\n';
+    for (const auto& result : results)
+        std::cout << result.to_string() << '\n';
+    std::cout << std::format("dense and sparse results {} map results\n",
+                             same ? "match" : "DIFFER from");
+    return same;
+}
+
+// Writes lines of "power coefficient" adding up to about count tokens,
+// two polynomials split by an empty line. Powers repeat every 10000
+// lines, so the polynomials stay small and the tokens dominate.
+inline void generate_input(const std::string& path, size_t count)
+{
+    std::ofstream file{path, std::ios::binary};
+    std::vector<char> block;
+    const size_t lines{count / 3};
+    for (size_t line{0}; line < lines; ++line)
+    {
+        char numbers[32];
+        char* last{std::to_chars(numbers, numbers + 16, line % 10'000).ptr};
+        *last++ = ' ';
+        last = std::to_chars(last, numbers + 31, line * 7 % 1'000'003).ptr;
+        *last++ = '\n';
+        block.insert(block.end(), numbers, last);
+        if (line + 1 == lines / 2)
+            block.push_back('\n');
+        if (block.size() >= (size_t{1} << 20) || line + 1 == lines)
+        {
+            file.write(block.data(),
+                       static_cast<std::streamsize>(block.size()));
+            block.clear();
+        }
+    }
+    if (!file.flush())
+        throw std::runtime_error(
+            std::format("[FATAL] Can't write file \"{}\"!", path));
+}
+
+// Seconds to lex and parse path with the token stream stored as variant
+// says: "list" as the old std::list<Token>, "buffer" as a TokenBuffer,
+// anything else not at all
+inline double parse_with(std::string_view variant, const std::string& path)
+{
+    using namespace LexerParser;
+    const auto start{std::chrono::steady_clock::now()};
+    Parser parser(path);
+    if (variant == "list")
+    {
+        Lexer lexer(path);
+        std::list<Token> tokens;
+        for (const Token& token : lexer)
+            tokens.push_back(token);
+        tokens.emplace_back(TokenType::Eof);
+        parser.parse(tokens);
+    }
+    else if (variant == "buffer")
+    {
+        Lexer lexer(path);
+        const TokenBuffer tokens(lexer);
+        parser.parse(tokens);
+    }
+    else
+        parser.parse();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                         start)
+        .count();
+}
+
+// Runs every variant of parse_with() in a child process of its own, so
+// that each one gets its own peak RSS
+inline bool token_benchmark(const std::string& path)
+{
+    std::cout << std::format("{:<8}{:>12}{:>16}\n", "tokens", "seconds",
+                             "peak RSS MiB");
+    bool succeeded{true};
+    for (const std::string_view variant : {"list", "buffer", "stream"})
+    {
+        int channel[2];
+        if (::pipe(channel) < 0)
+            throw std::runtime_error("[FATAL] Can't create a pipe!");
+
+        const pid_t child{::fork()};
+        if (child == 0)
+        {
+            ::close(channel[0]);
+            int status{EXIT_SUCCESS};
+            try
+            {
+                const double seconds{parse_with(variant, path)};
+                status = ::write(channel[1], &seconds, sizeof(seconds)) ==
+                                 sizeof(seconds)
+                             ? EXIT_SUCCESS
+                             : EXIT_FAILURE;
+            }
+            catch (const std::exception& ex)
+            {
+                std::cerr << std::format("{}\n", ex.what());
+                status = EXIT_FAILURE;
+            }
+            ::_exit(status);
+        }
+
+        ::close(channel[1]);
+        double seconds{0};
+        const bool have_time{::read(channel[0], &seconds, sizeof(seconds)) ==
+                             sizeof(seconds)};
+        ::close(channel[0]);
+
+        int status{0};
+        rusage usage{};
+        ::wait4(child, &status, 0, &usage);
+        if (child < 0 || !have_time || !WIFEXITED(status) ||
+            WEXITSTATUS(status) != EXIT_SUCCESS)
+        {
+            std::cout << std::format("{:<8}{:>12}\n", variant, "failed");
+            succeeded = false;
+            continue;
+        }
+        // ru_maxrss is in KiB on Linux
+        std::cout << std::format("{:<8}{:>12.3f}{:>16.1f}\n", variant, seconds,
+                                 usage.ru_maxrss / 1024.0);
+    }
+    return succeeded;
+}
+
+// Time of one product of two polynomials of every size with each method
+// that finishes in reasonable time. Returns whether all methods, and the
+// sparse product, agree.
+inline bool multiply_benchmark()
+{
+    using LexerParser::PolynomProcessor;
+    using LexerParser::Product;
+    using polynom_multiply::method;
+
+    Timer measure;
+    benchmark_options options;
+    options.samples = 5;
+    std::vector<benchmark_result> results;
+    bool same{true};
+
+    uint64_t seed{12345};
+    const auto random_polynom{[&seed](size_t size)
+                              {
+                                  std::vector<int64_t> polynom(size);
+                                  for (int64_t& coefficient : polynom)
+                                  {
+                                      seed = seed * 6'364'136'223'846'793'005 +
+                                             1'442'695'040'888'963'407;
+                                      coefficient = static_cast<int32_t>(
+                                          seed >> 32);
+                                  }
+                                  return polynom;
+                              }};
+
+    for (const size_t size : {size_t{64}, size_t{256}, size_t{1'024},
+                              size_t{4'096}, size_t{16'384}, size_t{65'536},
+                              size_t{262'144}})
+    {
+        const std::vector<int64_t> lhs{random_polynom(size)};
+        const std::vector<int64_t> rhs{random_polynom(size)};
+        std::vector<int64_t> expected;
+
+        const auto run{[&](std::string_view name, method how,
+                           unsigned threads = 1)
+                       {
+                           const auto product{polynom_multiply::multiply(
+                               lhs, rhs, how, threads)};
+                           if (expected.empty())
+                               expected = product;
+                           same = same && product == expected;
+                           results.push_back(measure.benchmark(
+                               std::format("{} {}", name, size),
+                               [&]
+                               {
+                                   return polynom_multiply::multiply(
+                                              lhs, rhs, how, threads)
+                                       .size();
+                               },
+                               options));
+                       }};
+
+        if (size <= 16'384)
+            run("schoolbook", method::schoolbook);
+        if (size <= 65'536)
+            run("karatsuba", method::karatsuba);
+        run("ntt", method::ntt);
+        if (size * 2 >= polynom_multiply::PARALLEL_MIN)
+        {
+            run("ntt 3 threads", method::ntt, 3);
+            run("ntt 8 threads", method::ntt, 8);
+        }
+    }
+
+    // sparse against dense on powers 0 to 6000
+    const std::map<int, int> sparse1{{0, 7}, {3, -2}, {5'000, INT_MAX},
+                                     {6'000, 11}};
+    std::map<int, int> sparse2;
+    for (int power{0}; power < 3'000; power += 7)
+        sparse2.emplace(power, INT_MAX - power);
+    const Product dense_product{
+        PolynomProcessor::multiply_dense(sparse1, sparse2)};
+    const Product sparse_product{
+        PolynomProcessor::multiply_sparse(sparse1, sparse2)};
+    for (int64_t power{0}; power < 9'000; ++power)
+        same = same && dense_product[power] == sparse_product[power];
+
+    std::cout << benchmark_result::header() << '\n';
+    for (const auto& result : results)
+        std::cout << result.to_string() << '\n';
+    std::cout << std::format("products {}\n", same ? "match" : "DIFFER");
+    return same;
+}
+
+int main(int argc, char* argv[])
 {
+    probe::install();
+
+    if (argc >= 3 && std::string_view{argv[1]} == "--generate")
+    {
+        const size_t count{argc > 3 ? std::stoull(argv[3]) : 100'000'000};
+        generate_input(argv[2], count);
+        return EXIT_SUCCESS;
+    }
+    if (argc == 3 && std::string_view{argv[1]} == "--bench")
+        return token_benchmark(argv[2]) ? EXIT_SUCCESS : EXIT_FAILURE;
+    if (argc == 2 && std::string_view{argv[1]} == "--bench-arithmetic")
+        return arithmetic_benchmark() ? EXIT_SUCCESS : EXIT_FAILURE;
+    if (argc == 2 && std::string_view{argv[1]} == "--bench-multiply")
+        return multiply_benchmark() ? EXIT_SUCCESS : EXIT_FAILURE;
+
+    if (argc == 2 && std::string_view{argv[1]} == "--multiply")
+    {
+        try
+        {
+            LexerParser::PolynomProcessor proc;
+            const LexerParser::Product product{proc.multiply()};
+
+            std::cout << "[DEBUG] Product: \n";
+            product.for_each(
+                [](int64_t power, int64_t base)
+                {
+                    std::cout << std::format("[DEBUG] Power: {}, base: {}\n",
+                                             power, base);
+                });
+        }
+        catch (const std::exception& ex)
+        {
+            std::cerr << std::format("{}\n", ex.what());
+            exit(EXIT_FAILURE);
+        }
+        return EXIT_SUCCESS;
+    }
+
     try
     {
         LexerParser::Lexer lexer;
-        lexer.parse();
+        const LexerParser::TokenBuffer tokens(lexer);
 
         std::cout << "[DEBUG] Lexer has read theese tokens:\n";
-        for (const LexerParser::Token& token : lexer.get_tokens())
+        for (size_t i{0}; i < tokens.size(); ++i)
         {
+            const LexerParser::Token token{tokens[i]};
             switch (token.type)
             {
             case LexerParser::TokenType::Newline:
@@ -360,16 +1338,20 @@ int main()
     try
     {
         LexerParser::PolynomProcessor proc;
-        auto result = proc(std::plus());
+        const auto result = proc(std::plus<int>());
 
         std::cout << "[DEBUG] Result: \n";
-        std::ranges::for_each(result,
-                              [](const auto& element)
-                              {
-                                  std::cout << std::format(
-                                      "[DEBUG] Power: {}, base: {}\n",
-                                      element.first, element.second);
-                              });
+        std::visit(
+            [](const auto& polynom)
+            {
+                polynom.for_each(
+                    [](size_t power, int base)
+                    {
+                        std::cout << std::format(
+                            "[DEBUG] Power: {}, base: {}\n", power, base);
+                    });
+            },
+            result);
     }
     catch (const std::exception& ex)
     {